@@ -0,0 +1,92 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec2 shape_a;		// per instance, see ShapeInstance
+layout(location = 1) in vec2 shape_b;
+layout(location = 2) in float shape_width;
+layout(location = 3) in uint shape_kind;
+layout(location = 4) in vec4 shape_color;
+
+uniform vec2 u_Center;		// data space point at the middle of the viewport
+uniform vec2 u_Scale;		// data units to NDC
+uniform float u_DataPerPixel;	// antialiasing width
+
+out vec2 v_Position;		// data space
+flat out vec2 v_A;
+flat out vec2 v_B;
+flat out float v_Width;
+flat out uint v_Kind;
+flat out vec4 v_Color;
+
+void main() {
+   /* 4 vertex strip: (0, 0), (1, 0), (0, 1), (1, 1) */
+   vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+   float pad = u_DataPerPixel;	// room for the antialiased edge
+   vec2 position;
+
+   if (shape_kind == 1u) {
+      /* lines get a quad along the segment, caps included */
+      vec2 segment = shape_b - shape_a;
+      float segment_length = length(segment);
+      vec2 along = segment_length > 0.0 ? segment / segment_length : vec2(1.0, 0.0);
+      vec2 across = vec2(-along.y, along.x);
+      float reach = shape_width + pad;
+      position = mix(shape_a - along * reach, shape_b + along * reach, corner.x) + across * reach * (corner.y * 2.0 - 1.0);
+   } else if (shape_kind == 2u) {
+      float reach = shape_b.x + pad;
+      position = shape_a + vec2(reach) * (corner * 2.0 - 1.0);
+   } else {
+      vec2 low = min(shape_a, shape_b) - pad;
+      vec2 high = max(shape_a, shape_b) + pad;
+      position = mix(low, high, corner);
+   }
+
+   v_Position = position;
+   v_A = shape_a;
+   v_B = shape_b;
+   v_Width = shape_width;
+   v_Kind = shape_kind;
+   v_Color = shape_color;
+   gl_Position = vec4((position - u_Center) * u_Scale, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+uniform float u_DataPerPixel;
+
+in vec2 v_Position;
+flat in vec2 v_A;
+flat in vec2 v_B;
+flat in float v_Width;
+flat in uint v_Kind;
+flat in vec4 v_Color;
+
+layout(location = 0) out vec4 shape_color;
+
+/* signed distances, negative inside: https://iquilezles.org/articles/distfunctions2d/ */
+void main() {
+   float d;
+   if (v_Kind == 1u) {
+      vec2 pa = v_Position - v_A;
+      vec2 ba = v_B - v_A;
+      float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-20), 0.0, 1.0);
+      d = length(pa - ba * h) - v_Width;
+   } else {
+      if (v_Kind == 2u) {
+	 d = length(v_Position - v_A) - v_B.x;
+      } else {
+	 vec2 q = abs(v_Position - 0.5 * (v_A + v_B)) - 0.5 * abs(v_B - v_A);
+	 d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0);
+      }
+      if (v_Width > 0.0) {
+	 d = abs(d + 0.5 * v_Width) - 0.5 * v_Width; // outline, inside the shape's edge
+      }
+   }
+
+   float coverage = clamp(0.5 - d / u_DataPerPixel, 0.0, 1.0);
+   if (coverage <= 0.0) {
+      discard;
+   }
+   shape_color = vec4(v_Color.rgb, v_Color.a * coverage);
+}
@@ -0,0 +1,25 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 debug_position;
+layout(location = 1) in vec4 debug_color;	// unorm8
+
+uniform mat4 u_MVP;
+
+out vec4 v_Color;
+
+void main() {
+   v_Color = debug_color;
+   gl_Position = u_MVP * vec4(debug_position, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in vec4 v_Color;
+
+layout(location = 0) out vec4 debug_color;
+
+void main() {
+   debug_color = v_Color;
+}
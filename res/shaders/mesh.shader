@@ -0,0 +1,30 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 vertex_position;
+layout(location = 1) in vec3 vertex_normal;
+
+uniform mat4 u_MVP;
+
+out vec3 v_Normal;
+
+void main() {
+   v_Normal = vertex_normal;
+   gl_Position = u_MVP * vec4(vertex_position, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+uniform vec4 u_Color;
+uniform vec3 u_LightDirection;	// model space, normalized
+
+in vec3 v_Normal;
+
+layout(location = 0) out vec4 mesh_color;
+
+void main() {
+   /* two sided, FEM surfaces are rarely consistently oriented */
+   float diffuse = abs(dot(normalize(v_Normal), u_LightDirection));
+   mesh_color = vec4(u_Color.rgb * (0.2 + 0.8 * diffuse), u_Color.a);
+}
@@ -0,0 +1,100 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 polyline_previous;	// per instance, xy and scalar, see PolylineWindow
+layout(location = 1) in vec3 polyline_start;
+layout(location = 2) in vec3 polyline_end;
+layout(location = 3) in vec3 polyline_next;
+
+uniform vec2 u_Center;		// data space point at the middle of the viewport
+uniform vec2 u_Scale;		// data units to NDC
+uniform vec2 u_HalfViewport;	// NDC to pixels
+uniform float u_HalfWidth;	// in pixels
+uniform vec2 u_ScalarRange;	// min, 1 / (max - min)
+uniform vec4 u_LowColor;
+uniform vec4 u_HighColor;
+
+out float v_Across;		// pixels from the center line
+out vec4 v_Color;
+
+/* break points have a NaN x, tested on the bits so no compiler can assume it away */
+bool isBreak(vec3 point) {
+   return (floatBitsToUint(point.x) & 0x7F800000u) == 0x7F800000u;
+}
+
+vec2 toPixels(vec2 position) {
+   return (position - u_Center) * u_Scale * u_HalfViewport;
+}
+
+vec2 normalOf(vec2 direction) {
+   return vec2(-direction.y, direction.x);
+}
+
+/* Offset from a join to the quad's corner, shared by both segments meeting there so they line
+ * up exactly: along the bisector of their normals, long enough to keep the width. Very sharp
+ * turns would shoot off, those are clamped to four widths and come out thinner at the tip */
+vec2 miter(vec2 normal, vec2 neighbour_normal, float reach) {
+   vec2 bisector = normal + neighbour_normal;
+   float bisector_length = length(bisector);
+   if (bisector_length < 1e-3) {
+      return normal * reach;	// folds straight back
+   }
+   bisector /= bisector_length;
+   return bisector * min(reach / max(dot(bisector, normal), 0.25), 4.0 * reach);
+}
+
+void main() {
+   /* 4 vertex strip: (0, 0), (1, 0), (0, 1), (1, 1), x runs along the segment, y across */
+   vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+   if (isBreak(polyline_start) || isBreak(polyline_end)) {
+      gl_Position = vec4(2.0, 2.0, 2.0, 1.0);	// straddles two polylines, all four corners in one spot
+      v_Across = 0.0;
+      v_Color = vec4(0.0);
+      return;
+   }
+
+   vec2 start = toPixels(polyline_start.xy);
+   vec2 end = toPixels(polyline_end.xy);
+   vec2 segment = end - start;
+   float segment_length = length(segment);
+   vec2 direction = segment_length > 0.0 ? segment / segment_length : vec2(1.0, 0.0);
+   vec2 normal = normalOf(direction);
+
+   float reach = u_HalfWidth + 1.0;	// a pixel of room for the antialiased edge
+   float side = corner.y * 2.0 - 1.0;
+   vec2 offset;
+   if (corner.x == 0.0) {
+      vec2 previous = toPixels(polyline_previous.xy);
+      bool joined = !isBreak(polyline_previous) && distance(previous, start) > 0.0;
+      offset = joined ? miter(normal, normalOf(normalize(start - previous)), reach) : normal * reach;
+   } else {
+      vec2 next = toPixels(polyline_next.xy);
+      bool joined = !isBreak(polyline_next) && distance(next, end) > 0.0;
+      offset = joined ? miter(normal, normalOf(normalize(next - end)), reach) : normal * reach;
+   }
+   vec2 position = mix(start, end, corner.x) + offset * side;
+
+   float scalar = mix(polyline_start.z, polyline_end.z, corner.x);
+   v_Color = mix(u_LowColor, u_HighColor, clamp((scalar - u_ScalarRange.x) * u_ScalarRange.y, 0.0, 1.0));
+   v_Across = reach * side;
+   gl_Position = vec4(position / u_HalfViewport, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+uniform float u_HalfWidth;
+
+in float v_Across;
+in vec4 v_Color;
+
+layout(location = 0) out vec4 polyline_color;
+
+void main() {
+   float coverage = clamp(u_HalfWidth + 0.5 - abs(v_Across), 0.0, 1.0);
+   if (coverage <= 0.0) {
+      discard;
+   }
+   polyline_color = vec4(v_Color.rgb, v_Color.a * coverage);
+}
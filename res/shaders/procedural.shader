@@ -0,0 +1,66 @@
+#shader vertex
+#version 330 core
+
+/* matches ProceduralPrimitive */
+struct Primitive {
+   vec4 corners;	// x0, y0, x1, y1
+   vec4 color;
+   vec4 width;		// x: line thickness or gap between grid cells
+   ivec4 info;		// kind (0 quad, 1 line, 2 grid), columns, rows
+};
+
+layout(std140) uniform Primitives {
+   Primitive u_Primitives[256];
+};
+
+uniform int u_Primitive;
+uniform vec2 u_Center;		// data space point at the middle of the viewport
+uniform vec2 u_Scale;		// data units to NDC
+
+out vec4 v_Color;
+
+/* two triangles over the unit square */
+const vec2 CORNERS[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+				vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0));
+
+void main() {
+   Primitive p = u_Primitives[u_Primitive];
+   vec2 corner = CORNERS[gl_VertexID];
+   vec2 a = p.corners.xy;
+   vec2 b = p.corners.zw;
+   vec2 position;
+
+   if (p.info.x == 1) {
+      /* thick line: a quad along the segment, width across it */
+      vec2 segment = b - a;
+      float segment_length = length(segment);
+      vec2 along = segment_length > 0.0 ? segment / segment_length : vec2(1.0, 0.0);
+      vec2 across = vec2(-along.y, along.x);
+      position = mix(a, b, corner.x) + across * p.width.x * (corner.y - 0.5);
+   } else if (p.info.x == 2) {
+      /* grid: this instance's cell, shrunk by half the gap on every side */
+      ivec2 cells = max(p.info.yz, ivec2(1));
+      ivec2 cell = ivec2(gl_InstanceID % cells.x, gl_InstanceID / cells.x);
+      vec2 cell_size = (b - a) / vec2(cells);
+      vec2 inset = sign(cell_size) * min(vec2(0.5 * p.width.x), 0.5 * abs(cell_size));
+      vec2 low = a + cell_size * vec2(cell) + inset;
+      vec2 high = low + cell_size - 2.0 * inset;
+      position = mix(low, high, corner);
+   } else {
+      position = mix(a, b, corner);
+   }
+
+   v_Color = p.color;
+   gl_Position = vec4((position - u_Center) * u_Scale, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in vec4 v_Color;
+
+layout(location = 0) out vec4 procedural_color;
+
+void main() {
+   procedural_color = v_Color;
+}
@@ -0,0 +1,104 @@
+#shader vertex
+#version 330 core
+#ifdef PULL_SSBO
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
+
+/* no attributes, everything is fetched as 32-bit words by index, see PulledPoints */
+#ifdef PULL_SSBO
+buffer PositionWords {
+   uint position_words[];
+};
+buffer ScalarWords {
+   uint scalar_words[];
+};
+#else
+uniform usamplerBuffer u_PositionWords;	// r32ui texture buffers over the same buffers
+uniform usamplerBuffer u_ScalarWords;
+#endif
+
+uniform uvec4 u_PositionLayout;	// first word, words per element, components, words per component
+uniform uvec4 u_ScalarLayout;	// same, 0 components when there are no scalars
+uniform vec2 u_ScalarRange;	// min, 1 / (max - min)
+uniform mat4 u_MVP;
+uniform float u_PointSize;
+
+out vec4 v_Color;
+
+uint positionWord(uint word) {
+#ifdef PULL_SSBO
+   return position_words[word];
+#else
+   return texelFetch(u_PositionWords, int(word)).r;
+#endif
+}
+
+uint scalarWord(uint word) {
+#ifdef PULL_SSBO
+   return scalar_words[word];
+#else
+   return texelFetch(u_ScalarWords, int(word)).r;
+#endif
+}
+
+/* little endian double to float by moving bits around, the mantissa is truncated.
+ * Too small for a float gives a signed zero, too large (inf and nan too) a signed infinity */
+float narrowDouble(uint low, uint high) {
+   uint sign = high & 0x80000000u;
+   int exponent = int((high >> 20) & 0x7FFu) - 1023 + 127;
+   if (exponent <= 0) {
+      return uintBitsToFloat(sign);
+   }
+   if (exponent >= 255) {
+      return uintBitsToFloat(sign | 0x7F800000u);
+   }
+   return uintBitsToFloat(sign | (uint(exponent) << 23) | ((high & 0xFFFFFu) << 3) | (low >> 29));
+}
+
+float fetchPosition(uint element, uint component) {
+   uint word = u_PositionLayout.x + element * u_PositionLayout.y + component * u_PositionLayout.w;
+   if (u_PositionLayout.w == 2u) {
+      return narrowDouble(positionWord(word), positionWord(word + 1u));
+   }
+   return uintBitsToFloat(positionWord(word));
+}
+
+float fetchScalar(uint element) {
+   uint word = u_ScalarLayout.x + element * u_ScalarLayout.y;
+   if (u_ScalarLayout.w == 2u) {
+      return narrowDouble(scalarWord(word), scalarWord(word + 1u));
+   }
+   return uintBitsToFloat(scalarWord(word));
+}
+
+void main() {
+   uint element = uint(gl_VertexID);
+   vec3 position = vec3(0.0);
+   for (uint c = 0u; c < u_PositionLayout.z; c++) {
+      position[c] = fetchPosition(element, c);
+   }
+
+   v_Color = vec4(1.0);
+   if (u_ScalarLayout.z != 0u) {
+      float t = clamp((fetchScalar(element) - u_ScalarRange.x) * u_ScalarRange.y, 0.0, 1.0);
+      v_Color = vec4(mix(vec3(0.15, 0.35, 0.9), vec3(1.0, 0.55, 0.1), t), 1.0);
+   }
+   gl_Position = u_MVP * vec4(position, 1.0);
+   gl_PointSize = u_PointSize;
+}
+
+#shader fragment
+#version 330 core
+
+in vec4 v_Color;
+
+layout(location = 0) out vec4 point_color;
+
+void main() {
+   /* round points */
+   vec2 from_center = gl_PointCoord * 2.0 - 1.0;
+   if (dot(from_center, from_center) > 1.0) {
+      discard;
+   }
+   point_color = v_Color;
+}
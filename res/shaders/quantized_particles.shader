@@ -0,0 +1,36 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 quantized_position;	// unorm16, [0, 1] across the chunk's box
+layout(location = 1) in float particle_scalar;		// half float, comes in as is
+layout(location = 2) in vec4 particle_color;		// unorm8
+
+uniform mat4 u_MVP;
+uniform vec3 u_ChunkMin;
+uniform vec3 u_ChunkExtent;
+uniform float u_PointSize;
+
+out vec4 v_Color;
+
+void main() {
+   vec3 position = u_ChunkMin + quantized_position * u_ChunkExtent;
+   gl_Position = u_MVP * vec4(position, 1.0);
+   gl_PointSize = max(1.0, u_PointSize * particle_scalar);
+   v_Color = particle_color;
+}
+
+#shader fragment
+#version 330 core
+
+in vec4 v_Color;
+
+layout(location = 0) out vec4 particle_color;
+
+void main() {
+   /* round points */
+   vec2 from_center = gl_PointCoord * 2.0 - 1.0;
+   if (dot(from_center, from_center) > 1.0) {
+      discard;
+   }
+   particle_color = v_Color;
+}
@@ -0,0 +1,45 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec2 sample_position;	// per instance
+layout(location = 1) in vec2 sample_vector;	// per instance
+
+uniform vec2 u_Center;
+uniform vec2 u_Scale;
+uniform float u_GlyphLength;		// data-space length of an arrow at max magnitude
+uniform float u_InvMaxMagnitude;
+
+out float v_Magnitude;
+
+/* unit arrow pointing along +x, the shaft is two triangles and the head is one */
+const vec2 arrow[9] = vec2[9](
+   vec2(0.0, -0.04), vec2(0.6, -0.04), vec2(0.6,  0.04),
+   vec2(0.0, -0.04), vec2(0.6,  0.04), vec2(0.0,  0.04),
+   vec2(0.6, -0.18), vec2(1.0,  0.0),  vec2(0.6,  0.18)
+);
+
+void main() {
+   float magnitude = length(sample_vector);
+   vec2 direction = magnitude > 0.0 ? sample_vector / magnitude : vec2(1.0, 0.0);
+
+   v_Magnitude = clamp(magnitude * u_InvMaxMagnitude, 0.0, 1.0);
+
+   vec2 local = arrow[gl_VertexID] * (u_GlyphLength * v_Magnitude);
+   vec2 rotated = vec2(direction.x * local.x - direction.y * local.y,
+		       direction.y * local.x + direction.x * local.y);
+
+   gl_Position = vec4((sample_position + rotated - u_Center) * u_Scale, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in float v_Magnitude;
+
+layout(location = 0) out vec4 glyph_color;
+
+void main() {
+   /* blue -> green -> red ramp over the normalized magnitude */
+   vec3 low = mix(vec3(0.1, 0.2, 1.0), vec3(0.1, 1.0, 0.2), clamp(v_Magnitude * 2.0, 0.0, 1.0));
+   glyph_color = vec4(mix(low, vec3(1.0, 0.15, 0.1), clamp(v_Magnitude * 2.0 - 1.0, 0.0, 1.0)), 1.0);
+}
@@ -0,0 +1,157 @@
+#include "Batch2D.h"
+
+#include <iostream> // input/output stream
+#include <math.h> // lrintf
+
+Batch2D::Batch2D(size_t stream_bytes, const std::string& shaderFilePath)
+   : m_VertexArray([] {
+	/* every attribute advances once per shape, pointers are set per draw */
+	for (const VertexAttribute& attribute : VertexFormat<ShapeInstance>::attributes) {
+	   GLCall(glVertexAttribDivisor(attribute.location, 1));	// https://docs.gl/gl4/glVertexAttribDivisor
+	}
+     }),
+     m_StreamCapacity(stream_bytes), m_StreamOffset(0), m_Current(0), m_Uploaded(false), m_Draws(0), m_Shapes(0) {
+   GLCall(glGenBuffers(1, &m_StreamBuffer));
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_StreamBuffer));
+   GLCall(glBufferData(GL_COPY_WRITE_BUFFER, m_StreamCapacity, nullptr, GL_STREAM_DRAW));	// https://docs.gl/gl4/glBufferData
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+   addMaterial(shaderFilePath);
+}
+
+Batch2D::~Batch2D() {
+   glDeleteBuffers(1, &m_StreamBuffer);
+   for (const Material& material : m_Materials) {
+      glDeleteProgram(material.program);
+   }
+}
+
+unsigned int Batch2D::addMaterial(const std::string& shaderFilePath) {
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+
+   Material material;
+   material.program = createShader(source.VertexSource, source.FragmentSource);
+   checkVertexInputs<ShapeInstance>(material.program, "ShapeInstance");
+   GLCall(material.center_location = glGetUniformLocation(material.program, "u_Center"));
+   GLCall(material.scale_location = glGetUniformLocation(material.program, "u_Scale"));
+   GLCall(material.data_per_pixel_location = glGetUniformLocation(material.program, "u_DataPerPixel"));
+   material.stream_offset = 0;
+
+   m_Materials.push_back(std::move(material));
+   return (unsigned int)m_Materials.size() - 1;
+}
+
+ShapeInstance& Batch2D::push(ShapeKind kind, const float color[4]) {
+   std::vector<ShapeInstance>& shapes = m_Materials[m_Current].shapes;
+   shapes.emplace_back();
+   ShapeInstance& shape = shapes.back();
+   shape.kind = kind;
+   m_Uploaded = false;
+   for (int c = 0; c < 4; c++) {
+      const float clamped = color[c] < 0.0f ? 0.0f : (color[c] > 1.0f ? 1.0f : color[c]);
+      shape.color[c] = (uint8_t)lrintf(clamped * 255.0f);
+   }
+   return shape;
+}
+
+void Batch2D::drawRect(float x0, float y0, float x1, float y1, const float color[4], float outline) {
+   ShapeInstance& shape = push(SHAPE_RECT, color);
+   shape.a[0] = x0; shape.a[1] = y0;
+   shape.b[0] = x1; shape.b[1] = y1;
+   shape.width = outline;
+}
+
+void Batch2D::drawLine(float x0, float y0, float x1, float y1, float thickness, const float color[4]) {
+   ShapeInstance& shape = push(SHAPE_LINE, color);
+   shape.a[0] = x0; shape.a[1] = y0;
+   shape.b[0] = x1; shape.b[1] = y1;
+   shape.width = 0.5f * thickness;
+}
+
+void Batch2D::drawCircle(float x, float y, float radius, const float color[4], float outline) {
+   ShapeInstance& shape = push(SHAPE_CIRCLE, color);
+   shape.a[0] = x; shape.a[1] = y;
+   shape.b[0] = radius; shape.b[1] = 0.0f;
+   shape.width = outline;
+}
+
+/* Every material's shapes back to back into the stream buffer. When they do not fit behind
+ * what earlier frames wrote the storage is orphaned: the driver hands out fresh memory and
+ * frees the old once the draws reading it are done, instead of making this upload wait. */
+void Batch2D::upload() {
+   if (m_Uploaded) {
+      return;
+   }
+
+   size_t bytes = 0;
+   for (const Material& material : m_Materials) {
+      bytes += material.shapes.size() * sizeof(ShapeInstance);
+   }
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_StreamBuffer));
+   if (bytes > m_StreamCapacity) {
+      m_StreamCapacity = bytes + bytes / 2;
+      m_StreamOffset = m_StreamCapacity; // forces the orphaning below to allocate the new size
+   }
+   if (m_StreamOffset + bytes > m_StreamCapacity) {
+      GLCall(glBufferData(GL_COPY_WRITE_BUFFER, m_StreamCapacity, nullptr, GL_STREAM_DRAW));
+      m_StreamOffset = 0;
+   }
+
+   for (Material& material : m_Materials) {
+      material.stream_offset = m_StreamOffset;
+      if (!material.shapes.empty()) {
+	 const size_t size = material.shapes.size() * sizeof(ShapeInstance);
+	 GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, m_StreamOffset, size, material.shapes.data()));	// https://docs.gl/gl4/glBufferSubData
+	 m_StreamOffset += size;
+      }
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+   m_Uploaded = true;
+}
+
+void Batch2D::flush(const View2D& view, int viewport_height) {
+   m_Draws = 0;
+   m_Shapes = 0;
+   ASSERT(m_Uploaded); // upload() on the primary first
+
+   const float scale_x = view.zoom / view.aspect;
+   const float scale_y = view.zoom;
+   const float data_per_pixel = 2.0f / (scale_y * (viewport_height > 0 ? viewport_height : 1));
+
+   GLboolean blending;
+   GLCall(glGetBooleanv(GL_BLEND, &blending));
+   GLCall(glEnable(GL_BLEND));		// https://docs.gl/gl4/glEnable
+   GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));	// https://docs.gl/gl4/glBlendFunc
+
+   m_VertexArray.bind();
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_StreamBuffer));
+   for (const Material& material : m_Materials) {
+      if (material.shapes.empty()) {
+	 continue;
+      }
+
+      GLCall(glUseProgram(material.program));
+      GLCall(glUniform2f(material.center_location, view.center_x, view.center_y));
+      GLCall(glUniform2f(material.scale_location, scale_x, scale_y));
+      GLCall(glUniform1f(material.data_per_pixel_location, data_per_pixel));
+
+      applyVertexLayout<ShapeInstance>(material.stream_offset);
+      GLCall(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)material.shapes.size()));	// https://docs.gl/gl4/glDrawArraysInstanced
+      m_Draws++;
+      m_Shapes += material.shapes.size();
+   }
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+   GLCall(glBindVertexArray(0));
+
+   if (!blending) {
+      GLCall(glDisable(GL_BLEND));
+   }
+}
+
+void Batch2D::clear() {
+   for (Material& material : m_Materials) {
+      material.shapes.clear(); // keeps the capacity, a steady frame does not allocate
+   }
+   m_Uploaded = false;
+}
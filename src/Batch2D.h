@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Views.h"
+#include "VertexLayout.h"
+
+#include <stdint.h> // uint32_t, uint8_t
+#include <vector>
+
+enum ShapeKind : uint32_t {
+   SHAPE_RECT = 0,
+   SHAPE_LINE,
+   SHAPE_CIRCLE,
+};
+
+/* One shape, this is also the per-instance layout on the gpu. The vertex shader grows a quad
+ * around it and the fragment shader cuts the shape out with its signed distance, so every
+ * kind is one instance of the same 4-vertex strip with antialiased edges for free. */
+struct ShapeInstance {
+   float a[2];		// rect corner, line start, circle center
+   float b[2];		// opposite rect corner, line end, (radius, 0) for circles
+   float width;		// line half-width, outline width for rects and circles (0 fills them)
+   uint32_t kind;
+   uint8_t color[4];
+};
+
+template<> struct VertexFormat<ShapeInstance> {
+   static constexpr VertexAttribute attributes[] = {
+      VERTEX_ATTRIBUTE(ShapeInstance, a, 0, "shape_a", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(ShapeInstance, b, 1, "shape_b", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(ShapeInstance, width, 2, "shape_width", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(ShapeInstance, kind, 3, "shape_kind", ATTRIBUTE_INTEGER),
+      VERTEX_ATTRIBUTE(ShapeInstance, color, 4, "shape_color", ATTRIBUTE_NORMALIZED),
+   };
+};
+
+/* Collects rects, lines and circles in data space during the frame, upload() sends them and
+ * flush() draws them, one instanced draw per material no matter how many shapes. Instances go
+ * into a streaming buffer that is orphaned when it runs full, so an upload never waits for last
+ * frame's draws.
+ * A material is a program with the same inputs as batch2d.shader, material 0 is that one.
+ * Shapes keep their submission order within a material, materials are drawn in id order. */
+class Batch2D {
+private:
+   struct Material {
+      unsigned int program;
+      int center_location;
+      int scale_location;
+      int data_per_pixel_location;
+      std::vector<ShapeInstance> shapes;
+      size_t stream_offset;	// where shapes went in the stream buffer
+   };
+
+   ContextVertexArray m_VertexArray;
+   unsigned int m_StreamBuffer;
+   size_t m_StreamCapacity;	// in bytes
+   size_t m_StreamOffset;	// next free byte
+   std::vector<Material> m_Materials;
+   unsigned int m_Current;
+   bool m_Uploaded;		// since the last clear()
+
+   size_t m_Draws;		// last flush()
+   size_t m_Shapes;
+
+   ShapeInstance& push(ShapeKind kind, const float color[4]);
+
+public:
+   explicit Batch2D(size_t stream_bytes = 1 << 20, const std::string& shaderFilePath = "../res/shaders/batch2d.shader");
+   ~Batch2D();
+
+   Batch2D(const Batch2D&) = delete;
+   Batch2D& operator=(const Batch2D&) = delete;
+
+   /* another program fed by ShapeInstance, returns its material id */
+   unsigned int addMaterial(const std::string& shaderFilePath);
+   /* shapes from here on use this material */
+   void setMaterial(unsigned int material) { m_Current = material; }
+
+   /* colors are rgba in [0, 1], outline 0 fills the shape */
+   void drawRect(float x0, float y0, float x1, float y1, const float color[4], float outline = 0.0f);
+   void drawLine(float x0, float y0, float x1, float y1, float thickness, const float color[4]);
+   void drawCircle(float x, float y, float radius, const float color[4], float outline = 0.0f);
+
+   /* sends what was collected since the last clear(). Once per frame on the primary's context,
+    * before ViewSet::drawAll: that flushes the primary before the other contexts read it */
+   void upload();
+   /* Draws what was uploaded with view, viewport_height is in pixels and sets the antialiasing
+    * width. Blends over what is there, leaves blending as it was. Can be called once per viewport */
+   void flush(const View2D& view, int viewport_height);
+   /* end of frame, drops the collected shapes */
+   void clear();
+
+   size_t drawCalls() const { return m_Draws; }
+   size_t shapeCount() const { return m_Shapes; }
+};
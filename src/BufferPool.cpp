@@ -0,0 +1,130 @@
+#include "BufferPool.h"
+
+#include <iostream> // input/output stream
+#include <algorithm> // std::sort, std::max
+
+BufferPool::BufferPool(GpuResources& resources, size_t unit_bytes, uint32_t capacity, uint32_t max_slices)
+   : m_Resources(resources), m_UnitBytes(unit_bytes), m_Allocator(capacity, max_slices), m_UsedUnits(0) {
+   m_Buffer = m_Resources.createBuffer(GL_COPY_WRITE_BUFFER, capacity * unit_bytes, nullptr, GL_DYNAMIC_DRAW);
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+/* Re-specifies the pool's storage at new_capacity_bytes and puts the old contents back at the
+ * start. Respecifying keeps the name, so vertex arrays pointing at it need no rebuild. The
+ * scratch copy goes through the resource table and dies once the gpu is done with it. */
+void BufferPool::copyThroughScratch(size_t new_capacity_bytes) {
+   const size_t old_bytes = (size_t)m_Allocator.size() * m_UnitBytes;
+   BufferHandle scratch = m_Resources.createBuffer(GL_COPY_WRITE_BUFFER, old_bytes, nullptr, GL_STREAM_COPY);
+
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Buffer.get()));
+   GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_bytes));	// https://docs.gl/gl4/glCopyBufferSubData
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer.get()));
+   GLCall(glBufferData(GL_COPY_WRITE_BUFFER, new_capacity_bytes, nullptr, GL_DYNAMIC_DRAW));	// https://docs.gl/gl4/glBufferData
+   m_Buffer.setBytes(new_capacity_bytes);
+
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, scratch.get()));
+   GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_bytes));
+
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+BufferPool::SliceId BufferPool::allocate(uint32_t units) {
+   OffsetAllocator::Allocation allocation = m_Allocator.allocate(units);
+   if (allocation.node == OffsetAllocator::NO_SPACE) {
+      /* the new end block, whatever was free at the end plus the growth, has to be one the
+       * allocator is sure to find for units, an exact fit could be passed over */
+      const uint32_t needed = m_Allocator.size() - m_Allocator.tailFree() + OffsetAllocator::fitSize(units);
+      const uint32_t capacity = std::max(m_Allocator.size() * 2, needed);
+      copyThroughScratch((size_t)capacity * m_UnitBytes);
+      m_Allocator.grow(capacity);
+      allocation = m_Allocator.allocate(units);
+      if (allocation.node == OffsetAllocator::NO_SPACE) {
+	 std::cout << "[BufferPool]: no allocator node left for " << units << " units, raise max_slices" << std::endl;
+	 return NO_SLICE;
+      }
+   }
+
+   SliceId slice;
+   if (!m_FreeSlices.empty()) {
+      slice = m_FreeSlices.back();
+      m_FreeSlices.pop_back();
+      m_Slices[slice] = allocation;
+   } else {
+      slice = (SliceId)m_Slices.size();
+      m_Slices.push_back(allocation);
+   }
+   m_UsedUnits += units;
+   return slice;
+}
+
+void BufferPool::free(SliceId slice) {
+   if (slice == NO_SLICE || m_Slices[slice].node == OffsetAllocator::NO_SPACE) {
+      return;
+   }
+   m_UsedUnits -= m_Allocator.allocationSize(m_Slices[slice]);
+   m_Allocator.free(m_Slices[slice]);
+   m_Slices[slice] = OffsetAllocator::Allocation();
+   m_FreeSlices.push_back(slice);
+}
+
+void BufferPool::upload(SliceId slice, const void* data, uint32_t units, uint32_t first) {
+   ASSERT(first + units <= size(slice));
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer.get()));
+   GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, (byteOffset(slice) + (size_t)first * m_UnitBytes), (size_t)units * m_UnitBytes, data));	// https://docs.gl/gl4/glBufferSubData
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void BufferPool::defragment() {
+   std::vector<SliceId> live;
+   for (SliceId slice = 0; slice < m_Slices.size(); slice++) {
+      if (m_Slices[slice].node != OffsetAllocator::NO_SPACE) {
+	 live.push_back(slice);
+      }
+   }
+   std::sort(live.begin(), live.end(), [this](SliceId a, SliceId b) { return m_Slices[a].offset < m_Slices[b].offset; });
+
+   /* packed into scratch, runs of slices that already touch go in one copy */
+   BufferHandle scratch = m_Resources.createBuffer(GL_COPY_WRITE_BUFFER, std::max<size_t>(m_UsedUnits, 1) * m_UnitBytes, nullptr, GL_STREAM_COPY);
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Buffer.get()));
+   size_t packed = 0;
+   for (size_t i = 0; i < live.size();) {
+      const uint32_t run_offset = m_Slices[live[i]].offset;
+      uint32_t run_end = run_offset;
+      for (; i < live.size() && m_Slices[live[i]].offset == run_end; i++) {
+	 run_end += m_Allocator.allocationSize(m_Slices[live[i]]);
+      }
+      GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)run_offset * m_UnitBytes,
+				 packed * m_UnitBytes, (size_t)(run_end - run_offset) * m_UnitBytes));
+      packed += run_end - run_offset;
+   }
+
+   /* the packed offsets are set as they are, allocating them again could fail to place the
+    * last slice: a tightly packed range leaves no room for bins to round up into */
+   std::vector<uint32_t> sizes(live.size());
+   std::vector<OffsetAllocator::Allocation> packed_slices(live.size());
+   for (size_t i = 0; i < live.size(); i++) {
+      sizes[i] = m_Allocator.allocationSize(m_Slices[live[i]]);
+   }
+   m_Allocator.resetPacked(sizes.data(), (uint32_t)live.size(), packed_slices.data());
+   for (size_t i = 0; i < live.size(); i++) {
+      m_Slices[live[i]] = packed_slices[i];
+   }
+
+   if (packed > 0) {
+      GLCall(glBindBuffer(GL_COPY_READ_BUFFER, scratch.get()));
+      GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer.get()));
+      GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, packed * m_UnitBytes));
+   }
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+float BufferPool::fragmentation() const {
+   const uint32_t free_storage = m_Allocator.freeStorage();
+   if (free_storage == 0) {
+      return 0.0f;
+   }
+   return 1.0f - (float)m_Allocator.largestFree() / free_storage;
+}
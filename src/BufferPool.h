@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Renderer.h"
+#include "GpuResources.h"
+#include "OffsetAllocator.h"
+
+#include <stdint.h> // uint32_t
+#include <vector>
+
+/* Many small vertex or index ranges carved out of one big GL buffer, so thousands of drawables
+ * cost one buffer object and can share a vertex array and a multi-draw. Offsets and sizes are in
+ * units of unit_bytes: make a pool per vertex format and the offset is directly the base vertex
+ * of glDrawElementsBaseVertex, or for indices the first index.
+ * Slice ids stay valid through growing and defragment(), the offsets behind them do not, look
+ * them up at draw time. The buffer name itself never changes, so vertex arrays built on it
+ * stay valid too: growing and compacting copy through a scratch buffer on the gpu. */
+class BufferPool {
+public:
+   using SliceId = uint32_t;
+   static const SliceId NO_SLICE = 0xFFFFFFFF;
+
+private:
+   GpuResources& m_Resources;
+   BufferHandle m_Buffer;
+   size_t m_UnitBytes;
+   OffsetAllocator m_Allocator;
+
+   std::vector<OffsetAllocator::Allocation> m_Slices;	// by id, node NO_SPACE when unused
+   std::vector<SliceId> m_FreeSlices;
+   size_t m_UsedUnits;
+
+   void copyThroughScratch(size_t new_capacity_bytes);
+
+public:
+   BufferPool(GpuResources& resources, size_t unit_bytes, uint32_t capacity, uint32_t max_slices = 64 * 1024);
+
+   BufferPool(const BufferPool&) = delete;
+   BufferPool& operator=(const BufferPool&) = delete;
+
+   /* grows the buffer (doubling) when there is no block large enough */
+   SliceId allocate(uint32_t units);
+   void free(SliceId slice);
+
+   uint32_t offset(SliceId slice) const { return m_Slices[slice].offset; }
+   size_t byteOffset(SliceId slice) const { return (size_t)m_Slices[slice].offset * m_UnitBytes; }
+   uint32_t size(SliceId slice) const { return m_Allocator.allocationSize(m_Slices[slice]); }
+
+   /* units from data into the slice, first units in. Binds GL_COPY_WRITE_BUFFER */
+   void upload(SliceId slice, const void* data, uint32_t units, uint32_t first = 0);
+
+   /* packs every live slice to the front in offset order, leaving one free block at the end */
+   void defragment();
+   /* 0 when all free space is one block, towards 1 the more it is split up */
+   float fragmentation() const;
+
+   unsigned int buffer() const { return m_Buffer.get(); }
+   uint32_t capacity() const { return m_Allocator.size(); }
+   size_t usedUnits() const { return m_UsedUnits; }
+};
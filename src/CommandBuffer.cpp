@@ -0,0 +1,159 @@
+#include "CommandBuffer.h"
+
+#include <algorithm> // std::sort
+#include <string.h> // memcpy
+#include <stdint.h> // uintptr_t
+
+uint64_t renderKey(unsigned int layer, unsigned int program, const ContextVertexArray* vertex_array, unsigned int depth) {
+   /* only groups, replay compares the real values. Pointers are at least 16 aligned */
+   const uint64_t array_bits = ((uintptr_t)vertex_array >> 4) & 0xFFFF;
+   return ((uint64_t)(layer & 0xFF) << 56) | ((uint64_t)(program & 0xFFFF) << 40) | (array_bits << 24) | (depth & 0xFFFFFF);
+}
+
+///-------------///
+///- RECORDING -///
+///-------------///
+
+void CommandBuffer::draw(unsigned int layer, unsigned int depth, const DrawCommand& draw) {
+   ASSERT(layer >= 1);
+   RenderCommand command;
+   command.key = renderKey(layer, draw.program, draw.vertex_array, depth);
+   command.type = COMMAND_DRAW;
+   command.draw = draw;
+   m_Commands.push_back(command);
+}
+
+void CommandBuffer::upload(unsigned int buffer, size_t offset, size_t size, const void* data) {
+   RenderCommand command;
+   command.key = 0;
+   command.type = COMMAND_UPLOAD;
+   command.upload.buffer = buffer;
+   command.upload.offset = offset;
+   command.upload.size = size;
+   command.upload.payload = m_Payload.size();
+   m_Payload.resize(m_Payload.size() + size);
+   memcpy(m_Payload.data() + command.upload.payload, data, size);
+   m_Commands.push_back(command);
+}
+
+void CommandBuffer::clear() {
+   m_Commands.clear();
+   m_Payload.clear();
+}
+
+///--------------///
+///- SUBMISSION -///
+///--------------///
+
+CommandQueue::CommandQueue()
+   : m_UsedBuffers(0), m_IsSorted(false), m_StateChanges(0) {
+}
+
+size_t CommandQueue::prepare(size_t count) {
+   const size_t first = m_UsedBuffers;
+   m_UsedBuffers += count;
+   if (m_Buffers.size() < m_UsedBuffers) {
+      m_Buffers.resize(m_UsedBuffers);
+   }
+   for (size_t i = first; i < m_UsedBuffers; i++) {
+      m_Buffers[i].clear();
+   }
+   m_IsSorted = false;
+   return first;
+}
+
+/* buffer and command index break ties, so equal keys replay in recording order */
+void CommandQueue::sort() {
+   m_Sorted.clear();
+   for (size_t b = 0; b < m_UsedBuffers; b++) {
+      for (size_t c = 0; c < m_Buffers[b].size(); c++) {
+	 m_Sorted.push_back({ m_Buffers[b].command(c).key, (uint32_t)b, (uint32_t)c });
+      }
+   }
+
+   std::sort(m_Sorted.begin(), m_Sorted.end(), [](const SortEntry& a, const SortEntry& b) {
+      if (a.key != b.key) return a.key < b.key;
+      if (a.buffer != b.buffer) return a.buffer < b.buffer;
+      return a.command < b.command;
+   });
+   m_IsSorted = true;
+}
+
+void CommandQueue::upload() {
+   if (!m_IsSorted) {
+      sort();
+   }
+
+   /* layer 0, all of them sort in front of the first draw */
+   for (const SortEntry& entry : m_Sorted) {
+      const CommandBuffer& buffer = m_Buffers[entry.buffer];
+      const RenderCommand& command = buffer.command(entry.command);
+      if (command.type != COMMAND_UPLOAD) {
+	 break;
+      }
+      /* the copy target, so the bound vertex array's element buffer stays as it is */
+      const UploadCommand& upload = command.upload;
+      GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, upload.buffer));
+      GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, upload.offset, upload.size, buffer.payload(upload.payload)));	// https://docs.gl/gl4/glBufferSubData
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void CommandQueue::submit() {
+   if (!m_IsSorted) {
+      sort();
+   }
+
+   unsigned int program = 0;
+   ContextVertexArray* vertex_array = nullptr;
+   unsigned int texture = 0;
+   m_StateChanges = 0;
+
+   for (const SortEntry& entry : m_Sorted) {
+      const CommandBuffer& buffer = m_Buffers[entry.buffer];
+      const RenderCommand& command = buffer.command(entry.command);
+
+      if (command.type == COMMAND_UPLOAD) {
+	 continue;	// upload() ran those
+      }
+
+      const DrawCommand& draw = command.draw;
+      if (draw.program != program) {
+	 program = draw.program;
+	 GLCall(glUseProgram(program));
+	 m_StateChanges++;
+      }
+      if (draw.vertex_array != vertex_array) {
+	 vertex_array = draw.vertex_array;
+	 if (vertex_array) {
+	    vertex_array->bind();
+	 }
+	 m_StateChanges++;
+      }
+      if (draw.texture != 0 && draw.texture != texture) {
+	 texture = draw.texture;
+	 GLCall(glActiveTexture(GL_TEXTURE0));	// https://docs.gl/gl4/glActiveTexture
+	 GLCall(glBindTexture(GL_TEXTURE_2D, texture));	// https://docs.gl/gl4/glBindTexture
+	 m_StateChanges++;
+      }
+      if (draw.color_location >= 0) {
+	 GLCall(glUniform4fv(draw.color_location, 1, draw.color));	// https://docs.gl/gl4/glUniform
+      }
+
+      if (draw.index_type == 0) {
+	 GLCall(glDrawArraysInstanced(draw.mode, (GLint)draw.first, draw.count, draw.instances));	// https://docs.gl/gl4/glDrawArraysInstanced
+      } else {
+	 GLCall(glDrawElementsInstancedBaseVertex(draw.mode, draw.count, draw.index_type, (const void*)draw.first,
+						  draw.instances, draw.base_vertex));	// https://docs.gl/gl4/glDrawElementsInstancedBaseVertex
+      }
+   }
+}
+
+void CommandQueue::reset() {
+   for (size_t b = 0; b < m_UsedBuffers; b++) {
+      m_Buffers[b].clear();
+   }
+   m_UsedBuffers = 0;
+   m_Sorted.clear();
+   m_IsSorted = false;
+}
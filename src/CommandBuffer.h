@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Renderer.h"
+#include "JobSystem.h"
+#include "Views.h"
+
+#include <stdint.h> // uint64_t
+#include <vector>
+
+enum RenderCommandType : unsigned int {
+   COMMAND_UPLOAD = 0,
+   COMMAND_DRAW,
+};
+
+/* Everything a draw binds, so replay can skip whatever the previous draw already bound.
+ * index_type 0 is glDrawArrays with first as the first vertex, otherwise first is the
+ * byte offset into the vertex array's element buffer */
+struct DrawCommand {
+   unsigned int program = 0;
+   ContextVertexArray* vertex_array = nullptr;	// nullptr draws with whatever is bound
+   unsigned int texture = 0;	// GL_TEXTURE_2D on unit 0, 0 leaves the binding alone
+   GLenum mode = GL_TRIANGLES;
+   GLenum index_type = 0;
+   GLsizei count = 0;
+   size_t first = 0;
+   GLint base_vertex = 0;
+   GLsizei instances = 1;
+   GLint color_location = -1;	// optional per-draw vec4, -1 for none
+   float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+/* buffer subrange write, the data lives in the recording CommandBuffer's payload */
+struct UploadCommand {
+   unsigned int buffer = 0;
+   size_t offset = 0;
+   size_t size = 0;
+   size_t payload = 0;
+};
+
+struct RenderCommand {
+   uint64_t key;
+   RenderCommandType type;
+   DrawCommand draw;
+   UploadCommand upload;
+};
+
+/* Sort key, most significant first: layer (8 bits), program (16), vertex array (16),
+ * depth (24). Layer 0 is taken by uploads so they always replay before any draw */
+uint64_t renderKey(unsigned int layer, unsigned int program, const ContextVertexArray* vertex_array, unsigned int depth);
+
+/* Commands recorded by one task. Recording touches no GL, so any thread can do it */
+class CommandBuffer {
+private:
+   std::vector<RenderCommand> m_Commands;
+   std::vector<unsigned char> m_Payload;
+
+public:
+   /* layer >= 1, depth is 24 bits and orders draws that share program and vertex array */
+   void draw(unsigned int layer, unsigned int depth, const DrawCommand& draw);
+   /* data is copied, it may go away right after the call */
+   void upload(unsigned int buffer, size_t offset, size_t size, const void* data);
+
+   void clear();
+
+   size_t size() const { return m_Commands.size(); }
+   const RenderCommand& command(size_t i) const { return m_Commands[i]; }
+   const unsigned char* payload(size_t offset) const { return m_Payload.data() + offset; }
+};
+
+/* Collects the command buffers of a frame. record() runs scene building on the job system, one
+ * buffer per task, upload() and submit() merge them by key on the GL thread and replay with
+ * redundant binds skipped. Buffers keep their capacity, so a steady frame does not allocate */
+class CommandQueue {
+private:
+   struct SortEntry {
+      uint64_t key;
+      uint32_t buffer;
+      uint32_t command;
+   };
+
+   std::vector<CommandBuffer> m_Buffers;
+   size_t m_UsedBuffers;
+   std::vector<SortEntry> m_Sorted;
+   bool m_IsSorted;
+
+   size_t m_StateChanges;	// last submit
+
+   /* readies count cleared buffers after the ones in use, returns the first */
+   size_t prepare(size_t count);
+   void sort();
+
+public:
+   CommandQueue();
+
+   /* record(CommandBuffer&, task) for every task below task_count, spread over the workers.
+    * May be called several times per frame, GL thread only */
+   template<typename Record>
+   void record(JobSystem& jobs, size_t task_count, Record&& record) {
+      const size_t first = prepare(task_count);
+      jobs.parallelFor(task_count, [&](size_t task) { record(m_Buffers[first + task], task); }, 1);
+   }
+
+   /* runs the uploads recorded this frame. Once per frame on the primary's context, before
+    * ViewSet::drawAll: that flushes the primary before the other contexts read the buffers */
+   void upload();
+   /* replays the draws recorded this frame into the current context, once per viewport */
+   void submit();
+   /* end of frame, drops all recorded commands */
+   void reset();
+
+   size_t commandCount() const { return m_Sorted.size(); }
+   size_t stateChanges() const { return m_StateChanges; }
+};
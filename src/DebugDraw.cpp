@@ -0,0 +1,262 @@
+#include "DebugDraw.h"
+#include "Views.h"
+
+#include <iostream> // input/output stream
+#include <math.h> // lrintf
+
+/* vertices per arena chunk, 16 KB */
+static const size_t CHUNK_VERTICES = 1024;
+
+enum DebugClass {
+   DEBUG_POINTS = 0,
+   DEBUG_LINES,
+   DEBUG_TRIANGLES,
+   DEBUG_CLASSES,
+};
+
+static const GLenum CLASS_MODES[DEBUG_CLASSES] = { GL_POINTS, GL_LINES, GL_TRIANGLES };
+
+struct DebugChunk {
+   DebugChunk* next;
+   size_t count;
+   DebugVertex vertices[CHUNK_VERTICES];
+};
+
+/* one list of chunks per primitive class, all in the frame arena */
+struct DebugList {
+   DebugChunk* head;
+   DebugChunk* tail;
+   size_t count;
+   size_t stream_first;	// first vertex in the stream buffer, once uploaded
+};
+
+struct DebugState {
+   FrameArena* arena;
+   ContextVertexArray* vertex_array;
+   unsigned int buffer;
+   size_t buffer_capacity;	// in vertices
+   unsigned int shader;
+   int mvp_location;
+
+   DebugList lists[DEBUG_CLASSES];
+   bool uploaded;
+
+   /* the primitive being recorded */
+   bool recording;	// between begin and end
+   GLenum mode;
+   size_t emitted;	// vertices given since begin
+   DebugVertex first;	// for loops and fans
+   DebugVertex previous;
+   DebugVertex before_previous;	// for strips
+   uint8_t color[4];
+};
+
+static DebugState* debug_state = nullptr;
+
+static void append(DebugClass primitive, const DebugVertex& vertex) {
+   DebugList& list = debug_state->lists[primitive];
+   if (!list.tail || list.tail->count == CHUNK_VERTICES) {
+      DebugChunk* chunk = debug_state->arena->allocate<DebugChunk>(1);
+      chunk->next = nullptr;
+      chunk->count = 0;
+      if (list.tail) {
+	 list.tail->next = chunk;
+      } else {
+	 list.head = chunk;
+      }
+      list.tail = chunk;
+   }
+   list.tail->vertices[list.tail->count++] = vertex;
+   list.count++;
+   debug_state->uploaded = false;
+}
+
+void dbg::init(FrameArena& arena, const std::string& shaderFilePath) {
+   ASSERT(!debug_state);
+   debug_state = new DebugState();
+   DebugState& state = *debug_state;
+
+   state.arena = &arena;
+   state.buffer_capacity = 0;
+   state.uploaded = false;
+   state.recording = false;
+   state.mode = GL_POINTS;
+   state.emitted = 0;
+   for (int c = 0; c < 4; c++) {
+      state.color[c] = 255;
+   }
+   clear();
+
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+   state.shader = createShader(source.VertexSource, source.FragmentSource);
+   checkVertexInputs<DebugVertex>(state.shader, "DebugVertex");
+   GLCall(state.mvp_location = glGetUniformLocation(state.shader, "u_MVP"));
+
+   GLCall(glGenBuffers(1, &state.buffer));
+   state.vertex_array = new ContextVertexArray([] {
+      GLCall(glBindBuffer(GL_ARRAY_BUFFER, debug_state->buffer));
+      applyVertexLayout<DebugVertex>();
+      GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+   });
+}
+
+void dbg::shutdown() {
+   if (!debug_state) {
+      return;
+   }
+   delete debug_state->vertex_array;
+   glDeleteBuffers(1, &debug_state->buffer);
+   glDeleteProgram(debug_state->shader);
+   delete debug_state;
+   debug_state = nullptr;
+}
+
+void dbg::begin(GLenum mode) {
+   ASSERT(debug_state && !debug_state->recording); // no nesting, like glBegin
+   debug_state->recording = true;
+   debug_state->mode = mode;
+   debug_state->emitted = 0;
+}
+
+void dbg::color(float r, float g, float b, float a) {
+   const float rgba[4] = { r, g, b, a };
+   for (int c = 0; c < 4; c++) {
+      const float clamped = rgba[c] < 0.0f ? 0.0f : (rgba[c] > 1.0f ? 1.0f : rgba[c]);
+      debug_state->color[c] = (uint8_t)lrintf(clamped * 255.0f);
+   }
+}
+
+/* strips, loops and fans become lists right here, so all of a class batches into one draw */
+void dbg::vertex(float x, float y, float z) {
+   DebugState& state = *debug_state;
+   DebugVertex v = { { x, y, z }, { state.color[0], state.color[1], state.color[2], state.color[3] } };
+   if (!state.recording) {
+      std::cout << "[DebugDraw]: vertex outside begin / end" << std::endl;
+      ASSERT(false);
+      return;
+   }
+   const size_t n = state.emitted++;
+
+   switch (state.mode) {
+   case GL_POINTS:
+      append(DEBUG_POINTS, v);
+      break;
+   case GL_LINES:
+   case GL_TRIANGLES:
+      append(state.mode == GL_LINES ? DEBUG_LINES : DEBUG_TRIANGLES, v);
+      break;
+   case GL_LINE_STRIP:
+   case GL_LINE_LOOP:
+      if (n > 0) {
+	 append(DEBUG_LINES, state.previous);
+	 append(DEBUG_LINES, v);
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      if (n > 1) {
+	 /* every other triangle is flipped so they all keep the strip's winding */
+	 append(DEBUG_TRIANGLES, n % 2 ? state.previous : state.before_previous);
+	 append(DEBUG_TRIANGLES, n % 2 ? state.before_previous : state.previous);
+	 append(DEBUG_TRIANGLES, v);
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      if (n > 1) {
+	 append(DEBUG_TRIANGLES, state.first);
+	 append(DEBUG_TRIANGLES, state.previous);
+	 append(DEBUG_TRIANGLES, v);
+      }
+      break;
+   default:
+      std::cout << "[DebugDraw]: unsupported mode " << state.mode << std::endl;
+      ASSERT(false);
+   }
+
+   if (n == 0) {
+      state.first = v;
+   }
+   state.before_previous = state.previous;
+   state.previous = v;
+}
+
+void dbg::end() {
+   DebugState& state = *debug_state;
+   ASSERT(state.recording);
+
+   if (state.mode == GL_LINE_LOOP && state.emitted > 1) {
+      append(DEBUG_LINES, state.previous);
+      append(DEBUG_LINES, state.first);
+   }
+   state.recording = false;
+}
+
+/* all three lists back to back into an orphaned buffer, each class ends up contiguous */
+void dbg::upload() {
+   DebugState& state = *debug_state;
+   ASSERT(!state.recording);
+   if (state.uploaded) {
+      return;
+   }
+   size_t total = 0;
+   for (const DebugList& list : state.lists) {
+      total += list.count;
+   }
+   if (total == 0) {
+      state.uploaded = true;
+      return;
+   }
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, state.buffer));
+   if (total > state.buffer_capacity) {
+      state.buffer_capacity = total + total / 2;
+   }
+   GLCall(glBufferData(GL_COPY_WRITE_BUFFER, state.buffer_capacity * sizeof(DebugVertex), nullptr, GL_STREAM_DRAW));	// https://docs.gl/gl4/glBufferData
+
+   size_t written = 0;
+   for (DebugList& list : state.lists) {
+      list.stream_first = written;
+      for (const DebugChunk* chunk = list.head; chunk; chunk = chunk->next) {
+	 GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, written * sizeof(DebugVertex), chunk->count * sizeof(DebugVertex), chunk->vertices));	// https://docs.gl/gl4/glBufferSubData
+	 written += chunk->count;
+      }
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+   state.uploaded = true;
+}
+
+void dbg::flush(const float* mvp) {
+   DebugState& state = *debug_state;
+   ASSERT(!state.recording);
+   if (vertexCount() == 0) {
+      return;
+   }
+   ASSERT(state.uploaded); // upload() first, and nothing recorded after it
+
+   GLCall(glUseProgram(state.shader));
+   GLCall(glUniformMatrix4fv(state.mvp_location, 1, GL_FALSE, mvp));	// https://docs.gl/gl4/glUniform
+   state.vertex_array->bind();
+   for (int c = 0; c < DEBUG_CLASSES; c++) {
+      if (state.lists[c].count > 0) {
+	 GLCall(glDrawArrays(CLASS_MODES[c], (GLint)state.lists[c].stream_first, (GLsizei)state.lists[c].count));	// https://docs.gl/gl4/glDrawArrays
+      }
+   }
+   GLCall(glBindVertexArray(0));
+}
+
+void dbg::clear() {
+   for (DebugList& list : debug_state->lists) {
+      list.head = nullptr;
+      list.tail = nullptr;
+      list.count = 0;
+      list.stream_first = 0;
+   }
+   debug_state->uploaded = false;
+}
+
+size_t dbg::vertexCount() {
+   size_t count = 0;
+   for (const DebugList& list : debug_state->lists) {
+      count += list.count;
+   }
+   return count;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Renderer.h"
+#include "FrameArena.h"
+#include "VertexLayout.h"
+
+#include <stdint.h> // uint8_t
+
+struct DebugVertex {
+   float position[3];
+   uint8_t color[4];
+};
+
+template<> struct VertexFormat<DebugVertex> {
+   static constexpr VertexAttribute attributes[] = {
+      VERTEX_ATTRIBUTE(DebugVertex, position, 0, "debug_position", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(DebugVertex, color, 1, "debug_color", ATTRIBUTE_NORMALIZED),
+   };
+};
+
+/* glBegin / glVertex / glEnd for debug overlays, without the fixed function pipeline.
+ * Nothing reaches GL until flush(): vertices are appended to chunks in the frame arena, strips,
+ * loops and fans are unrolled into plain lists on the way in, and every primitive class
+ * (points, lines, triangles) goes out as one draw. Cheap enough to leave calls in hot paths.
+ *
+ *    dbg::begin(GL_LINE_LOOP);
+ *    dbg::color(1, 0, 0);
+ *    dbg::vertex(x0, y0); dbg::vertex(x1, y0); dbg::vertex(x1, y1); dbg::vertex(x0, y1);
+ *    dbg::end();
+ *
+ * GL thread only, and everything recorded is gone once the arena resets: clear() first. */
+namespace dbg {
+   /* the arena is where vertices are recorded, it has to outlive shutdown() */
+   void init(FrameArena& arena, const std::string& shaderFilePath = "../res/shaders/debug.shader");
+   void shutdown();
+
+   /* GL_POINTS, GL_LINES, GL_LINE_STRIP, GL_LINE_LOOP, GL_TRIANGLES, GL_TRIANGLE_STRIP or GL_TRIANGLE_FAN */
+   void begin(GLenum mode);
+   void vertex(float x, float y, float z = 0.0f);
+   void end();
+
+   /* sticky like glColor, also allowed outside begin / end */
+   void color(float r, float g, float b, float a = 1.0f);
+
+   /* sends what was recorded since the last clear(). Once per frame on the primary's context,
+    * before ViewSet::drawAll: that flushes the primary before the other contexts read it */
+   void upload();
+   /* draws what was uploaded, mvp is a column-major 4x4 matrix. Can be called once per viewport */
+   void flush(const float* mvp);
+   /* end of frame, before the arena is reset */
+   void clear();
+
+   size_t vertexCount();
+}
@@ -0,0 +1,210 @@
+#include "DepthSort.h"
+
+#include <string.h> // memcpy, memset
+#include <algorithm> // std::min
+
+static const size_t MIN_BLOCK_SIZE = 1 << 16;	// smaller blocks cost more in histograms than they gain
+static const int RADIX_BITS = 8;
+static const size_t RADIX_BUCKETS = 1 << RADIX_BITS;
+
+/* Maps a float onto an unsigned int with the same ordering, then flips it so that
+ * ascending keys are descending depth (back-to-front) */
+static inline unsigned int depthKey(float depth) {
+   unsigned int bits;
+   memcpy(&bits, &depth, sizeof(bits));
+   bits ^= (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+   return ~bits;
+}
+
+DepthSort::DepthSort(JobSystem& jobs)
+   : m_Jobs(jobs), m_BufferCapacity(0), m_LastMethod(Method::RADIX) {
+   GLCall(glGenBuffers(1, &m_IndexBuffer));
+}
+
+DepthSort::~DepthSort() {
+   glDeleteBuffers(1, &m_IndexBuffer);
+}
+
+size_t DepthSort::blockCount(size_t count) const {
+   return std::max<size_t>(1, std::min<size_t>(m_Jobs.size(), count / MIN_BLOCK_SIZE));
+}
+
+void DepthSort::sort(const float* x, const float* y, const float* z, size_t stride, size_t count,
+		     const float eye[3], const float view_direction[3]) {
+   bool restarted = false;
+   if (m_Order.size() != count) {
+      /* particle set changed, there is no previous order to start from */
+      m_Order.resize(count);
+      for (size_t i = 0; i < count; i++) {
+	 m_Order[i] = (unsigned int)i;
+      }
+      m_Keys.resize(count);
+      m_OrderScratch.resize(count);
+      m_KeysScratch.resize(count);
+      restarted = true;
+   }
+   if (count == 0) {
+      return;
+   }
+
+   /* keys in last frame's order, and count how often that order is now wrong */
+   const float dx = view_direction[0], dy = view_direction[1], dz = view_direction[2];
+   const float offset = eye[0] * dx + eye[1] * dy + eye[2] * dz;
+   const size_t blocks = blockCount(count);
+   const size_t block_size = (count + blocks - 1) / blocks;
+   m_Descents.assign(blocks, 0);
+
+   m_Jobs.parallelFor(blocks, [&](size_t block) {
+      const size_t begin = block * block_size;
+      const size_t end = std::min(count, begin + block_size);
+      size_t block_descents = 0;
+      for (size_t i = begin; i < end; i++) {
+	 const size_t p = (size_t)m_Order[i] * stride;
+	 m_Keys[i] = depthKey(x[p] * dx + y[p] * dy + z[p] * dz - offset);
+	 if (i > begin && m_Keys[i] < m_Keys[i - 1]) {
+	    block_descents++;
+	 }
+      }
+      m_Descents[block] = block_descents;
+   });
+
+   size_t total_descents = 0;
+   for (size_t block = 0; block < blocks; block++) {
+      total_descents += m_Descents[block];
+      if (block > 0) {
+	 const size_t boundary = block * block_size;
+	 total_descents += m_Keys[boundary] < m_Keys[boundary - 1] ? 1 : 0;
+      }
+   }
+
+   if (total_descents == 0) {
+      m_LastMethod = Method::UNCHANGED;
+   } else if (total_descents <= count / 256 && insertionSort(count * 4)) {
+      /* camera barely moved, a handful of particles swapped places */
+      m_LastMethod = Method::INSERTION;
+   } else {
+      radixSort();
+      m_LastMethod = Method::RADIX;
+   }
+
+   writeIndexBuffer(restarted || m_LastMethod != Method::UNCHANGED);
+}
+
+/* Sorts m_Keys/m_Order in place, gives up (returning false) once more than move_budget
+ * elements have been shifted so a badly disordered frame still costs O(n) before the radix sort */
+bool DepthSort::insertionSort(size_t move_budget) {
+   const size_t count = m_Keys.size();
+   size_t moves = 0;
+
+   for (size_t i = 1; i < count; i++) {
+      const unsigned int key = m_Keys[i];
+      if (key >= m_Keys[i - 1]) {
+	 continue;
+      }
+
+      const unsigned int index = m_Order[i];
+      size_t j = i;
+      while (j > 0 && m_Keys[j - 1] > key) {
+	 m_Keys[j] = m_Keys[j - 1];
+	 m_Order[j] = m_Order[j - 1];
+	 j--;
+      }
+      m_Keys[j] = key;
+      m_Order[j] = index;
+
+      moves += i - j;
+      if (moves > move_budget) {
+	 return false; // whatever is sorted so far is still a valid starting point for the radix sort
+      }
+   }
+   return true;
+}
+
+/* LSD radix sort, 8 bits per pass. Every pass: per-block histograms in parallel, a prefix sum
+ * over (digit, block) and a stable parallel scatter. Passes where every key has the same digit
+ * are skipped, which is common since depths of one scene rarely span the whole float range. */
+void DepthSort::radixSort() {
+   const size_t count = m_Keys.size();
+   const size_t blocks = blockCount(count);
+   const size_t block_size = (count + blocks - 1) / blocks;
+   m_Histograms.resize(blocks * RADIX_BUCKETS);
+
+   for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+      m_Jobs.parallelFor(blocks, [&](size_t block) {
+	 size_t* histogram = &m_Histograms[block * RADIX_BUCKETS];
+	 memset(histogram, 0, RADIX_BUCKETS * sizeof(size_t));
+
+	 const size_t end = std::min(count, (block + 1) * block_size);
+	 for (size_t i = block * block_size; i < end; i++) {
+	    histogram[(m_Keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+	 }
+      });
+
+      /* exclusive prefix sum, digit major so equal digits keep their block order (stability) */
+      size_t sum = 0;
+      bool single_bucket = false;
+      for (size_t digit = 0; digit < RADIX_BUCKETS; digit++) {
+	 size_t digit_total = 0;
+	 for (size_t block = 0; block < blocks; block++) {
+	    size_t& slot = m_Histograms[block * RADIX_BUCKETS + digit];
+	    const size_t n = slot;
+	    slot = sum;
+	    sum += n;
+	    digit_total += n;
+	 }
+	 if (digit_total == count) {
+	    single_bucket = true;
+	 }
+      }
+      if (single_bucket) {
+	 continue;
+      }
+
+      m_Jobs.parallelFor(blocks, [&](size_t block) {
+	 size_t* offsets = &m_Histograms[block * RADIX_BUCKETS];
+
+	 const size_t end = std::min(count, (block + 1) * block_size);
+	 for (size_t i = block * block_size; i < end; i++) {
+	    const size_t destination = offsets[(m_Keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+	    m_KeysScratch[destination] = m_Keys[i];
+	    m_OrderScratch[destination] = m_Order[i];
+	 }
+      });
+
+      m_Keys.swap(m_KeysScratch);
+      m_Order.swap(m_OrderScratch);
+   }
+}
+
+/* The order stays on the cpu for next frame, the copy into the mapped buffer is one streaming
+ * write per block, which is what write-combined memory wants (scattered writes would not be) */
+void DepthSort::writeIndexBuffer(bool order_changed) {
+   /* GL_COPY_WRITE_BUFFER so the element binding of whatever vao is bound stays untouched */
+   const size_t count = m_Order.size();
+   const size_t bytes = count * sizeof(unsigned int);
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_IndexBuffer));
+   if (count != m_BufferCapacity) {
+      GLCall(glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_DRAW));
+      m_BufferCapacity = count;
+      order_changed = true;
+   }
+
+   if (order_changed) {
+      /* invalidating lets the driver hand out fresh storage instead of waiting for last frame's draw */
+      GLCall(void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes,		// https://docs.gl/gl4/glMapBufferRange
+					     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+      if (mapped) {
+	 const size_t blocks = blockCount(count);
+	 const size_t block_size = (count + blocks - 1) / blocks;
+	 m_Jobs.parallelFor(blocks, [&](size_t block) {
+	    const size_t begin = block * block_size;
+	    const size_t end = std::min(count, begin + block_size);
+	    memcpy((unsigned int*)mapped + begin, &m_Order[begin], (end - begin) * sizeof(unsigned int));
+	 });
+	 GLCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));				// https://docs.gl/gl4/glUnmapBuffer
+      }
+   }
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Renderer.h"
+#include "JobSystem.h"
+
+#include <vector>
+
+/* Back-to-front ordering of translucent particles, written straight into an element buffer.
+ * Depth is the distance along the view direction. Frames start from last frame's order:
+ * if it is still sorted nothing is done, if only a few particles moved an insertion pass
+ * fixes it up, otherwise a parallel LSD radix sort over 32-bit keys runs on the job system. */
+class DepthSort {
+public:
+   enum class Method { UNCHANGED, INSERTION, RADIX };
+
+private:
+   JobSystem& m_Jobs;
+   unsigned int m_IndexBuffer;
+   size_t m_BufferCapacity;	// in indices
+
+   std::vector<unsigned int> m_Order;		// current back-to-front order
+   std::vector<unsigned int> m_Keys;		// keys in m_Order's order
+   std::vector<unsigned int> m_OrderScratch;
+   std::vector<unsigned int> m_KeysScratch;
+   std::vector<size_t> m_Histograms;		// 256 per block
+   std::vector<size_t> m_Descents;		// one per block, kept so sorting never allocates once warm
+
+   Method m_LastMethod;
+
+   size_t blockCount(size_t count) const;
+   bool insertionSort(size_t move_budget);
+   void radixSort();
+   void writeIndexBuffer(bool order_changed);
+
+public:
+   explicit DepthSort(JobSystem& jobs);
+   ~DepthSort();
+
+   DepthSort(const DepthSort&) = delete;
+   DepthSort& operator=(const DepthSort&) = delete;
+
+   /* Positions are read as x[i * stride], y[i * stride], z[i * stride], so both interleaved
+    * (x = p, y = p + 1, z = p + 2, stride = 3) and separate columns (stride = 1) work.
+    * eye is the camera position, view_direction points into the screen. GL thread only. */
+   void sort(const float* x, const float* y, const float* z, size_t stride, size_t count,
+	     const float eye[3], const float view_direction[3]);
+
+   unsigned int indexBuffer() const { return m_IndexBuffer; }	// GL_UNSIGNED_INT indices
+   const std::vector<unsigned int>& order() const { return m_Order; }
+   Method lastMethod() const { return m_LastMethod; }
+};
@@ -0,0 +1,96 @@
+#include "DirtyBuffer.h"
+
+#include <iostream> // input/output stream
+#include <algorithm> // std::sort, std::min, std::max
+#include <string.h> // memcpy
+
+DirtyBuffer::DirtyBuffer(unsigned int buffer, const void* data, size_t size, size_t merge_gap)
+   : m_Buffer(buffer), m_BufferOffset(0), m_Data((const unsigned char*)data), m_Size(size), m_MergeGap(merge_gap), m_RangeCount(0),
+     m_BytesUploaded(0), m_BytesSaved(0), m_UploadCalls(0), m_Flushes(0) {
+}
+
+void DirtyBuffer::markDirty(size_t offset, size_t size) {
+   const size_t end = std::min(offset + size, m_Size);
+   if (offset >= end) {
+      return;
+   }
+
+   if (m_RangeCount == MAX_RANGES) {
+      coalesce();
+   }
+   if (m_RangeCount == MAX_RANGES) {
+      /* still scattered after merging, one range over all of it */
+      Range hull = m_Ranges[0];
+      for (size_t i = 1; i < m_RangeCount; i++) {
+	 hull.end = std::max(hull.end, m_Ranges[i].end);
+      }
+      m_Ranges[0] = hull;
+      m_RangeCount = 1;
+   }
+   m_Ranges[m_RangeCount++] = { offset, end };
+}
+
+/* sorts the ranges and merges the ones that overlap or sit within m_MergeGap of each other */
+void DirtyBuffer::coalesce() {
+   std::sort(m_Ranges, m_Ranges + m_RangeCount, [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+   size_t merged = 0;
+   for (size_t i = 1; i < m_RangeCount; i++) {
+      if (m_Ranges[i].begin <= m_Ranges[merged].end + m_MergeGap) {
+	 m_Ranges[merged].end = std::max(m_Ranges[merged].end, m_Ranges[i].end);
+      } else {
+	 m_Ranges[++merged] = m_Ranges[i];
+      }
+   }
+   m_RangeCount = m_RangeCount > 0 ? merged + 1 : 0;
+}
+
+size_t DirtyBuffer::flush(FlushMode mode) {
+   if (m_RangeCount == 0) {
+      return 0;
+   }
+   coalesce();
+
+   size_t bytes = 0;
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer));
+   if (mode == FLUSH_MAPPED) {
+      const size_t first = m_Ranges[0].begin;
+      const size_t last = m_Ranges[m_RangeCount - 1].end;
+      /* the bytes in between are neither written nor flushed, their contents stay as they were */
+      GLCall(unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, m_BufferOffset + first, last - first,
+								     GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));	// https://docs.gl/gl4/glMapBufferRange
+      if (mapped) {
+	 for (size_t i = 0; i < m_RangeCount; i++) {
+	    const Range& range = m_Ranges[i];
+	    memcpy(mapped + (range.begin - first), m_Data + range.begin, range.end - range.begin);
+	    GLCall(glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, range.begin - first, range.end - range.begin));	// https://docs.gl/gl4/glFlushMappedBufferRange
+	    bytes += range.end - range.begin;
+	 }
+	 GLCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));	// https://docs.gl/gl4/glMapBuffer
+	 m_UploadCalls++;
+      } else {
+	 std::cout << "[DirtyBuffer]: glMapBufferRange failed, falling back to glBufferSubData" << std::endl;
+	 mode = FLUSH_SUBDATA;
+      }
+   }
+   if (mode == FLUSH_SUBDATA) {
+      for (size_t i = 0; i < m_RangeCount; i++) {
+	 const Range& range = m_Ranges[i];
+	 GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, m_BufferOffset + range.begin, range.end - range.begin, m_Data + range.begin));	// https://docs.gl/gl4/glBufferSubData
+	 bytes += range.end - range.begin;
+      }
+      m_UploadCalls += m_RangeCount;
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+   m_RangeCount = 0;
+   m_BytesUploaded += bytes;
+   m_BytesSaved += m_Size - bytes;
+   m_Flushes++;
+   return bytes;
+}
+
+void DirtyBuffer::printStats(const char* name) const {
+   std::cout << "[DirtyBuffer]: " << name << ": " << m_Flushes << " flushes, " << m_UploadCalls << " upload calls, "
+	     << m_BytesUploaded << " bytes uploaded, " << m_BytesSaved << " bytes saved" << std::endl;
+}
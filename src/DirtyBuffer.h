@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Renderer.h"
+
+#include <stddef.h> // size_t
+
+/* Tracks which bytes of a CPU copy changed since the last flush, and sends only those to the
+ * GL buffer that mirrors it. Ranges closer than merge_gap bytes are merged, one slightly larger
+ * upload beats two calls. Does not own either side: data is whatever array the caller writes
+ * to (it has to outlive this), buffer whatever GL buffer holds its copy. Never allocates,
+ * once the range table is full it folds everything into one covering range. GL thread only. */
+class DirtyBuffer {
+public:
+   enum FlushMode {
+      FLUSH_SUBDATA = 0,	// one glBufferSubData per merged range
+      FLUSH_MAPPED,		// one glMapBufferRange over all of them, glFlushMappedBufferRange each
+   };
+
+   static const size_t MAX_RANGES = 64;
+
+private:
+   struct Range {
+      size_t begin;
+      size_t end;
+   };
+
+   unsigned int m_Buffer;
+   size_t m_BufferOffset;	// where data[0] lives in the buffer
+   const unsigned char* m_Data;
+   size_t m_Size;
+   size_t m_MergeGap;
+
+   Range m_Ranges[MAX_RANGES];
+   size_t m_RangeCount;
+
+   /* over every flush so far */
+   size_t m_BytesUploaded;
+   size_t m_BytesSaved;		// against uploading all of it each time
+   size_t m_UploadCalls;
+   size_t m_Flushes;
+
+   void coalesce();
+
+public:
+   DirtyBuffer(unsigned int buffer, const void* data, size_t size, size_t merge_gap = 256);
+
+   /* size bytes from offset changed in data */
+   void markDirty(size_t offset, size_t size);
+   void markAll() { markDirty(0, m_Size); }
+   bool dirty() const { return m_RangeCount > 0; }
+
+   /* for data mirroring a slice of a larger buffer, BufferPool slices move on defragment() */
+   void setBufferOffset(size_t offset) { m_BufferOffset = offset; }
+
+   /* sends the dirty bytes, returns how many. Binds GL_COPY_WRITE_BUFFER, no vertex array state
+    * is touched. The mapped path does not unsynchronize, the driver still waits on pending draws */
+   size_t flush(FlushMode mode = FLUSH_SUBDATA);
+
+   size_t bytesUploaded() const { return m_BytesUploaded; }
+   size_t bytesSaved() const { return m_BytesSaved; }
+   size_t uploadCalls() const { return m_UploadCalls; }
+   void printStats(const char* name) const;
+};
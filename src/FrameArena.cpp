@@ -0,0 +1,128 @@
+#include "FrameArena.h"
+#include "Renderer.h"
+
+#include <iostream> // input/output stream
+#include <new> // std::bad_alloc, std::align_val_t
+#include <stdlib.h> // malloc, free
+#include <stdint.h> // uintptr_t
+
+/* malloc rather than new, the arena has to keep working while the guard below is armed */
+FrameArena::FrameArena(size_t capacity)
+   : m_Capacity(capacity), m_Used(0), m_Requested(0), m_HighWater(0), m_Overflow(nullptr) {
+   m_Memory = (unsigned char*)malloc(m_Capacity);
+   ASSERT(m_Memory);
+}
+
+FrameArena::~FrameArena() {
+   reset();
+   free(m_Memory);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+   m_Requested += size;
+
+   const uintptr_t base = (uintptr_t)m_Memory;
+   const size_t offset = ((base + m_Used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+   if (offset + size <= m_Capacity) {
+      m_Used = offset + size;
+      return m_Memory + offset;
+   }
+
+   /* does not fit this frame, the overflow block is only around until reset() */
+   const size_t header = (sizeof(Overflow) + alignment - 1) / alignment * alignment;
+   Overflow* block = (Overflow*)aligned_alloc(alignment < sizeof(void*) ? sizeof(void*) : alignment,
+					      (header + size + alignment - 1) / alignment * alignment);
+   ASSERT(block);
+   block->next = m_Overflow;
+   m_Overflow = block;
+   return (unsigned char*)block + header;
+}
+
+void FrameArena::reset() {
+   if (m_Requested > m_HighWater) {
+      m_HighWater = m_Requested;
+   }
+
+   if (m_Overflow) {
+      while (m_Overflow) {
+	 Overflow* next = m_Overflow->next;
+	 free(m_Overflow);
+	 m_Overflow = next;
+      }
+
+      /* a frame did not fit: grow once, with headroom for alignment padding */
+      m_Capacity = m_HighWater + m_HighWater / 4;
+      free(m_Memory);
+      m_Memory = (unsigned char*)malloc(m_Capacity);
+      ASSERT(m_Memory);
+   }
+
+   m_Used = 0;
+   m_Requested = 0;
+}
+
+///-----------------------///
+///- STEADY-STATE ALLOCS -///
+///-----------------------///
+
+#ifdef FRAME_ALLOCATION_CHECK
+
+static thread_local bool allocation_guard_armed = false;
+
+void FrameAllocationGuard::arm() { allocation_guard_armed = true; }
+void FrameAllocationGuard::disarm() { allocation_guard_armed = false; }
+bool FrameAllocationGuard::enabled() { return true; }
+
+static void reportFrameAllocation(size_t size) {
+   allocation_guard_armed = false; // printing may allocate too
+   std::cout << "[Frame allocation]: " << size << " bytes allocated with new in the steady-state loop" << std::endl;
+   ASSERT(false);
+}
+
+void* operator new(size_t size) {
+   if (allocation_guard_armed) {
+      reportFrameAllocation(size);
+   }
+   void* memory = malloc(size ? size : 1);
+   if (!memory) {
+      throw std::bad_alloc();
+   }
+   return memory;
+}
+
+void* operator new[](size_t size) {
+   return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+   if (allocation_guard_armed) {
+      reportFrameAllocation(size);
+   }
+   const size_t align = (size_t)alignment;
+   void* memory = aligned_alloc(align, (size + align - 1) / align * align);
+   if (!memory) {
+      throw std::bad_alloc();
+   }
+   return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+   return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { free(memory); }
+
+#else
+
+void FrameAllocationGuard::arm() {}
+void FrameAllocationGuard::disarm() {}
+bool FrameAllocationGuard::enabled() { return false; }
+
+#endif
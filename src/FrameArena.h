@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <type_traits>
+
+/* Linear allocator for data that only lives until the end of the frame: staging vertices,
+ * sort keys, text quads, command lists. Allocating is a pointer bump, nothing is freed one
+ * by one, reset() after the swap throws everything away at once.
+ * When a frame needs more than the capacity the rest comes from malloc'd overflow blocks,
+ * and reset() grows the arena so the next frame fits without them. */
+class FrameArena {
+private:
+   struct Overflow {
+      Overflow* next;
+   };
+
+   unsigned char* m_Memory;
+   size_t m_Capacity;
+   size_t m_Used;
+   size_t m_Requested;		// this frame, overflow included
+   size_t m_HighWater;		// over every frame so far
+   Overflow* m_Overflow;
+
+public:
+   explicit FrameArena(size_t capacity);
+   ~FrameArena();
+
+   FrameArena(const FrameArena&) = delete;
+   FrameArena& operator=(const FrameArena&) = delete;
+
+   void* allocate(size_t size, size_t alignment = alignof(max_align_t));
+
+   /* uninitialized, and never destructed, so only for plain data */
+   template<typename T>
+   T* allocate(size_t count) {
+      static_assert(std::is_trivially_destructible<T>::value, "frame arena memory is never destructed");
+      return (T*)allocate(count * sizeof(T), alignof(T));
+   }
+
+   /* end of frame, everything handed out since the last reset is gone */
+   void reset();
+
+   size_t used() const { return m_Requested; }
+   size_t capacity() const { return m_Capacity; }
+   size_t highWater() const { return m_HighWater; }
+};
+
+/* Debug check that the steady-state loop does not touch the heap. Built with
+ * -DFRAME_ALLOCATION_CHECK the global operator new is replaced, and any allocation on a
+ * thread while it is armed reports the size and traps. Without the flag these do nothing. */
+namespace FrameAllocationGuard {
+   void arm();
+   void disarm();
+   bool enabled();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+
+/* What changed since the last frame that was drawn */
+enum Damage : unsigned int {
+   DAMAGE_NONE     = 0,
+   DAMAGE_DATA     = 1 << 0,	// simulation data / vertex buffers
+   DAMAGE_CAMERA   = 1 << 1,	// view or projection
+   DAMAGE_UNIFORMS = 1 << 2,	// colors and other shader inputs
+   DAMAGE_WINDOW   = 1 << 3,	// exposed, resized, needs repainting
+};
+
+/* Damage tracking for the render loop. Anything that changes what ends up on screen marks it,
+ * from any thread, and when nothing is marked the loop waits for events instead of redrawing
+ * the same frame */
+struct FrameDamage {
+   std::atomic<unsigned int> flags{ DAMAGE_WINDOW }; // the very first frame always has to be drawn
+
+   void mark(unsigned int what) { flags.fetch_or(what, std::memory_order_release); }
+   bool any() const { return flags.load(std::memory_order_acquire) != DAMAGE_NONE; }
+   void clear() { flags.store(DAMAGE_NONE, std::memory_order_release); }
+
+   /* returns and clears in one step, so a mark landing while the frame is drawn is not lost */
+   unsigned int take() { return flags.exchange(DAMAGE_NONE, std::memory_order_acq_rel); }
+};
@@ -0,0 +1,361 @@
+#include "FrameLoader.h"
+
+#include <iostream> // input/output stream
+#include <stdlib.h> // aligned_alloc
+#include <string.h> // memset
+#include <errno.h> // errno
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap
+#include <sys/syscall.h> // syscall numbers
+#include <sys/uio.h> // iovec
+#include <unistd.h> // pread, close
+#include <linux/io_uring.h>
+
+static const size_t ALIGNMENT = 4096; // reads start on page boundaries, which O_DIRECT would also need
+
+/* there is no liburing in the tree, the three syscalls are all we need */
+static int ioUringSetup(unsigned int entries, struct io_uring_params* params) {
+   return (int)syscall(__NR_io_uring_setup, entries, params);		// https://www.man7.org/linux/man-pages/man2/io_uring_setup.2.html
+}
+
+static int ioUringEnter(int ring, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+   return (int)syscall(__NR_io_uring_enter, ring, to_submit, min_complete, flags, nullptr, 0);	// https://www.man7.org/linux/man-pages/man2/io_uring_enter.2.html
+}
+
+static int ioUringRegister(int ring, unsigned int opcode, const void* arg, unsigned int count) {
+   return (int)syscall(__NR_io_uring_register, ring, opcode, arg, count);	// https://www.man7.org/linux/man-pages/man2/io_uring_register.2.html
+}
+
+struct FrameLoader::Ring {
+   int fd = -1;
+
+   void* sq_mapping = MAP_FAILED;
+   size_t sq_mapping_size = 0;
+   void* cq_mapping = MAP_FAILED;
+   size_t cq_mapping_size = 0;
+   struct io_uring_sqe* sqes = (struct io_uring_sqe*)MAP_FAILED;
+   size_t sqes_size = 0;
+
+   std::atomic<unsigned int>* sq_head;
+   std::atomic<unsigned int>* sq_tail;
+   unsigned int sq_mask;
+   unsigned int* sq_array;
+
+   std::atomic<unsigned int>* cq_head;
+   std::atomic<unsigned int>* cq_tail;
+   unsigned int cq_mask;
+   struct io_uring_cqe* cqes;
+};
+
+FrameLoader::FrameLoader()
+   : m_File(-1), m_Ring(nullptr), m_QueueDepth(0), m_BufferSize(0), m_Ready(1), m_Released(1),
+     m_Stop(true), m_FirstStep(0), m_Generation(0) {
+}
+
+FrameLoader::~FrameLoader() {
+   close();
+}
+
+bool FrameLoader::open(const std::string& filePath, unsigned int queue_depth) {
+   close();
+
+   if (!m_Recording.open(filePath)) {
+      return false;
+   }
+   m_File = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+   if (m_File < 0) {
+      std::cout << "Recording file not open " << filePath << std::endl;
+      return false;
+   }
+
+   /* every slot fits the largest frame plus the slack from aligning its start down */
+   size_t largest = 0;
+   for (size_t step = 0; step < m_Recording.frameCount(); step++) {
+      largest = std::max<size_t>(largest, m_Recording.entry(step).size);
+   }
+   m_BufferSize = (largest + 2 * ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+   /* queue_depth reads in flight plus as many finished ones waiting for the render loop */
+   m_QueueDepth = std::max(1u, queue_depth);
+   const unsigned int slots = m_QueueDepth * 2;
+   m_Ready.reset(slots);
+   m_Released.reset(slots);
+   for (unsigned int slot = 0; slot < slots; slot++) {
+      unsigned char* buffer = (unsigned char*)aligned_alloc(ALIGNMENT, m_BufferSize);
+      if (!buffer) {
+	 std::cout << "Frame buffers of " << m_BufferSize << " bytes could not be allocated" << std::endl;
+	 close();
+	 return false;
+      }
+      m_Buffers.push_back(buffer);
+   }
+
+   if (!setupRing()) {
+      std::cout << "io_uring unavailable (" << strerror(errno) << "), loading frames with pread" << std::endl;
+   }
+   return true;
+}
+
+void FrameLoader::close() {
+   stop();
+   destroyRing();
+
+   for (unsigned char* buffer : m_Buffers) {
+      free(buffer);
+   }
+   m_Buffers.clear();
+
+   if (m_File >= 0) {
+      ::close(m_File);
+      m_File = -1;
+   }
+}
+
+bool FrameLoader::setupRing() {
+   struct io_uring_params params;
+   memset(&params, 0, sizeof(params));
+
+   Ring* ring = new Ring();
+   m_Ring = ring; // so destroyRing cleans up whatever got set up if a later step fails
+
+   ring->fd = ioUringSetup(m_QueueDepth, &params);
+   if (ring->fd < 0) {
+      destroyRing();
+      return false;
+   }
+
+   ring->sq_mapping_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+   ring->cq_mapping_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+   ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+   ring->sq_mapping = mmap(nullptr, ring->sq_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+   ring->cq_mapping = mmap(nullptr, ring->cq_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+   ring->sqes = (struct io_uring_sqe*)mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+   if (ring->sq_mapping == MAP_FAILED || ring->cq_mapping == MAP_FAILED || ring->sqes == MAP_FAILED) {
+      destroyRing();
+      return false;
+   }
+
+   unsigned char* sq = (unsigned char*)ring->sq_mapping;
+   ring->sq_head = (std::atomic<unsigned int>*)(sq + params.sq_off.head);
+   ring->sq_tail = (std::atomic<unsigned int>*)(sq + params.sq_off.tail);
+   ring->sq_mask = *(unsigned int*)(sq + params.sq_off.ring_mask);
+   ring->sq_array = (unsigned int*)(sq + params.sq_off.array);
+
+   unsigned char* cq = (unsigned char*)ring->cq_mapping;
+   ring->cq_head = (std::atomic<unsigned int>*)(cq + params.cq_off.head);
+   ring->cq_tail = (std::atomic<unsigned int>*)(cq + params.cq_off.tail);
+   ring->cq_mask = *(unsigned int*)(cq + params.cq_off.ring_mask);
+   ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+   /* registered buffers are pinned once here instead of on every read */
+   std::vector<struct iovec> buffers(m_Buffers.size());
+   for (size_t i = 0; i < m_Buffers.size(); i++) {
+      buffers[i].iov_base = m_Buffers[i];
+      buffers[i].iov_len = m_BufferSize;
+   }
+   if (ioUringRegister(ring->fd, IORING_REGISTER_BUFFERS, buffers.data(), (unsigned int)buffers.size()) < 0) {
+      destroyRing();
+      return false;
+   }
+
+   return true;
+}
+
+void FrameLoader::destroyRing() {
+   if (!m_Ring) {
+      return;
+   }
+
+   if (m_Ring->sqes != MAP_FAILED) munmap(m_Ring->sqes, m_Ring->sqes_size);
+   if (m_Ring->cq_mapping != MAP_FAILED) munmap(m_Ring->cq_mapping, m_Ring->cq_mapping_size);
+   if (m_Ring->sq_mapping != MAP_FAILED) munmap(m_Ring->sq_mapping, m_Ring->sq_mapping_size);
+   if (m_Ring->fd >= 0) ::close(m_Ring->fd); // also unregisters the buffers
+
+   delete m_Ring;
+   m_Ring = nullptr;
+}
+
+void FrameLoader::start(size_t first_step) {
+   stop();
+   if (m_File < 0) {
+      return;
+   }
+
+   /* frames from the last run are dropped and every slot is handed out again */
+   m_Ready.reset(m_Ready.capacity());
+   m_Released.reset(m_Released.capacity());
+
+   m_FirstStep = first_step;
+   m_Generation++;
+   m_Stop.store(false);
+   m_Thread = std::thread(&FrameLoader::loadLoop, this);
+}
+
+void FrameLoader::stop() {
+   if (!m_Thread.joinable()) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(m_WakeMutex);
+      m_Stop.store(true);
+   }
+   m_Wake.notify_one();
+   m_Thread.join();
+}
+
+void FrameLoader::release(const LoadedFrame& frame) {
+   if (frame.generation != m_Generation) {
+      return; // popped before a seek, start() already took every slot back
+   }
+   m_Released.push(frame.slot); // never full, there are only as many slots as it holds
+   {
+      std::lock_guard<std::mutex> lock(m_WakeMutex);
+   }
+   m_Wake.notify_one();
+}
+
+/* queues one read into a registered buffer, buffer_offset bytes in, submitted by the next io_uring_enter */
+void FrameLoader::submitRead(unsigned int slot, size_t file_offset, size_t buffer_offset, size_t length) {
+   const unsigned int tail = m_Ring->sq_tail->load(std::memory_order_relaxed);
+   const unsigned int index = tail & m_Ring->sq_mask;
+   struct io_uring_sqe* sqe = &m_Ring->sqes[index];
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode = IORING_OP_READ_FIXED;
+   sqe->fd = m_File;
+   sqe->off = file_offset;
+   sqe->addr = (unsigned long long)(m_Buffers[slot] + buffer_offset);
+   sqe->len = (unsigned int)length;
+   sqe->buf_index = (unsigned short)slot;
+   sqe->user_data = slot;
+   m_Ring->sq_array[index] = index;
+   m_Ring->sq_tail->store(tail + 1, std::memory_order_release);
+}
+
+void FrameLoader::loadLoop() {
+   const size_t frame_count = m_Recording.frameCount();
+   const unsigned int slots = (unsigned int)m_Buffers.size();
+
+   std::vector<unsigned int> free_slots;
+   for (unsigned int slot = slots; slot-- > 0;) {
+      free_slots.push_back(slot);
+   }
+
+   /* reads complete in any order, frames are handed over in step order */
+   struct Pending {
+      size_t step;
+      size_t skip;	// bytes between the aligned read start and the frame
+      size_t aligned;	// where the read starts in the file
+      size_t length;	// bytes asked for, page rounded
+      size_t read;	// bytes in so far, short reads are continued from here
+      bool done;
+      bool failed;
+   };
+   std::vector<Pending> pending(slots);
+   std::vector<unsigned int> order;	// slots in step order, front is the next one to deliver
+   size_t order_front = 0;
+   unsigned int in_flight = 0;
+   size_t next_step = m_FirstStep;
+
+   while (true) {
+      unsigned int slot;
+      while (m_Released.pop(slot)) {
+	 free_slots.push_back(slot);
+      }
+
+      if (m_Stop.load() && in_flight == 0) {
+	 break;
+      }
+
+      /* queue reads for as many upcoming frames as there are slots and queue depth */
+      unsigned int queued = 0;
+      while (!m_Stop.load() && next_step < frame_count && !free_slots.empty() && in_flight + queued < m_QueueDepth) {
+	 slot = free_slots.back();
+	 free_slots.pop_back();
+
+	 const RecordingIndexEntry& entry = m_Recording.entry(next_step);
+	 const size_t aligned = entry.offset / ALIGNMENT * ALIGNMENT;
+	 const size_t length = (entry.offset + entry.size - aligned + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	 Pending& request = pending[slot];
+	 request = { next_step, entry.offset - aligned, aligned, length, 0, false, false };
+	 order.push_back(slot);
+	 next_step++;
+
+	 if (m_Ring) {
+	    submitRead(slot, aligned, 0, length);
+	    queued++;
+	 } else {
+	    /* fallback, synchronous but still off the render thread */
+	    while (request.read < request.skip + entry.size) {
+	       const ssize_t result = pread(m_File, m_Buffers[slot] + request.read, length - request.read, aligned + request.read);
+	       if (result < 0 && errno == EINTR) {
+		  continue;
+	       }
+	       if (result <= 0) {
+		  std::cout << "Frame " << request.step << " could not be read: " << (result < 0 ? strerror(errno) : "end of file") << std::endl;
+		  request.failed = true;
+		  break;
+	       }
+	       request.read += result;
+	    }
+	    request.done = true;
+	 }
+      }
+
+      if (m_Ring && (queued > 0 || in_flight > 0)) {
+	 /* one syscall submits the whole batch (plus anything an interrupted call left behind)
+	  * and waits for at least one read to finish */
+	 in_flight += queued;
+	 const unsigned int unsubmitted = m_Ring->sq_tail->load(std::memory_order_relaxed) - m_Ring->sq_head->load(std::memory_order_acquire);
+	 int result = ioUringEnter(m_Ring->fd, unsubmitted, 1, IORING_ENTER_GETEVENTS);
+	 if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+	    std::cout << "io_uring_enter failed: " << strerror(errno) << std::endl;
+	 }
+
+	 unsigned int head = m_Ring->cq_head->load(std::memory_order_relaxed);
+	 while (head != m_Ring->cq_tail->load(std::memory_order_acquire)) {
+	    const struct io_uring_cqe& cqe = m_Ring->cqes[head & m_Ring->cq_mask];
+	    const unsigned int done = (unsigned int)cqe.user_data;
+	    Pending& request = pending[done];
+	    head++;
+
+	    /* short reads continue where they stopped, the read past the frame's end (up to the
+	     * page) may come up short at the end of the file */
+	    if (cqe.res > 0) {
+	       request.read += cqe.res;
+	       if (request.read < request.skip + m_Recording.entry(request.step).size) {
+		  submitRead(done, request.aligned + request.read, request.read, request.length - request.read);
+		  continue; // still in flight
+	       }
+	    } else if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+	       submitRead(done, request.aligned + request.read, request.read, request.length - request.read);
+	       continue;
+	    } else {
+	       std::cout << "Frame " << request.step << " could not be read: " << (cqe.res < 0 ? strerror(-cqe.res) : "end of file") << std::endl;
+	       request.failed = true;
+	    }
+	    request.done = true;
+	    in_flight--;
+	 }
+	 m_Ring->cq_head->store(head, std::memory_order_release);
+      }
+
+      /* hand over everything that is complete and next in line */
+      while (order_front < order.size() && pending[order[order_front]].done) {
+	 slot = order[order_front++];
+	 const size_t step = pending[slot].step;
+	 const bool failed = pending[slot].failed;
+	 m_Ready.push({ step, m_Recording.entry(step), failed ? nullptr : m_Buffers[slot] + pending[slot].skip, slot, m_Generation, failed });
+      }
+      if (order_front == order.size()) {
+	 order.clear();
+	 order_front = 0;
+      }
+
+      /* nothing to read right now: wait for the render loop to give a slot back */
+      if (in_flight == 0 && (free_slots.empty() || next_step >= frame_count)) {
+	 std::unique_lock<std::mutex> lock(m_WakeMutex);
+	 m_Wake.wait(lock, [&] { return m_Stop.load() || !m_Released.empty(); });
+      }
+   }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Recording.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A frame read into one of the loader's buffers, hand it back with release() once applied.
+ * A frame whose read failed still comes through, in order, with failed set and no data */
+struct LoadedFrame {
+   size_t step;
+   RecordingIndexEntry entry;
+   const unsigned char* data;	// entry.size bytes of payload, nullptr when failed
+   unsigned int slot;
+   unsigned int generation;	// start() count, frames from an earlier run are not taken back
+   bool failed;
+};
+
+/* Reads upcoming frames of a recording on its own thread with io_uring: fixed (registered)
+ * buffers, up to queue_depth reads in flight, submitted and reaped in batches. Finished frames
+ * go through a bounded queue in step order, so the render loop only ever does a non-blocking
+ * pop. Without io_uring (old kernel, seccomp) the same thread falls back to pread. */
+class FrameLoader {
+private:
+   struct Ring;			// io_uring mappings, only FrameLoader.cpp needs to know them
+
+   Recording m_Recording;		// for the index, the frames themselves are read with m_File
+   int m_File;
+   Ring* m_Ring;
+   unsigned int m_QueueDepth;
+
+   std::vector<unsigned char*> m_Buffers;	// one per slot, page aligned
+   size_t m_BufferSize;
+
+   SpscQueue<LoadedFrame> m_Ready;		// loader -> render loop
+   SpscQueue<unsigned int> m_Released;	// render loop -> loader
+
+   std::thread m_Thread;
+   std::atomic<bool> m_Stop;
+   std::mutex m_WakeMutex;
+   std::condition_variable m_Wake;	// a slot came back or stop() was called
+   size_t m_FirstStep;
+   unsigned int m_Generation;
+
+   void loadLoop();
+   void submitRead(unsigned int slot, size_t file_offset, size_t buffer_offset, size_t length);
+   bool setupRing();
+   void destroyRing();
+
+public:
+   FrameLoader();
+   ~FrameLoader();
+
+   FrameLoader(const FrameLoader&) = delete;
+   FrameLoader& operator=(const FrameLoader&) = delete;
+
+   bool open(const std::string& filePath, unsigned int queue_depth = 8);
+   void close();
+
+   /* loads first_step, first_step + 1, ... until the end or stop(). Seeking is stop() and
+    * start() from the target's keyframe, the frames up to the target still have to be applied */
+   void start(size_t first_step);
+   void stop();
+
+   /* render loop side, never blocks */
+   bool tryPop(LoadedFrame& frame) { return m_Ready.pop(frame); }
+   void release(const LoadedFrame& frame);
+
+   const Recording& recording() const { return m_Recording; }
+   bool usingIoUring() const { return m_Ring != nullptr; }
+};
@@ -0,0 +1,490 @@
+#include "FrameStreamer.h"
+
+#include <algorithm> // std::min
+#include <iostream> // input/output stream
+#include <stdlib.h> // atoi
+#include <string.h> // memcpy, memcmp, strerror
+#include <errno.h> // errno
+#include <arpa/inet.h> // htons, htonl
+#include <netinet/in.h> // sockaddr_in
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <poll.h> // poll
+#include <sys/eventfd.h> // eventfd
+#include <sys/socket.h> // socket, bind, listen, accept4, send
+#include <sys/un.h> // sockaddr_un
+#include <unistd.h> // close, unlink
+#include <zlib.h> // compress2
+
+/* zlib's fastest level, most of what there is to gain on rendered frames are flat regions anyway */
+static const int COMPRESSION_LEVEL = 1;
+static const size_t TILE_BYTES = FrameStreamer::TILE_SIZE * FrameStreamer::TILE_SIZE * 4;
+
+FrameStreamer::FrameStreamer(JobSystem& jobs)
+   : m_Jobs(jobs), m_NextReadback(0), m_FrameCounter(0), m_PreviousWidth(0), m_PreviousHeight(0),
+     m_Encoding(false), m_Published(nullptr), m_Stop(false), m_ListenSocket(-1), m_WakeFd(-1),
+     m_Current(nullptr), m_FramesEncoded(0), m_FramesDropped(0), m_BytesSent(0) {
+}
+
+FrameStreamer::~FrameStreamer() {
+   close();
+}
+
+static bool socketError(const char* what, int& socket_fd) {
+   std::cout << "[Frame streamer]: " << what << ": " << strerror(errno) << std::endl;
+   if (socket_fd >= 0) {
+      ::close(socket_fd);
+      socket_fd = -1;
+   }
+   return false;
+}
+
+bool FrameStreamer::open(const std::string& address) {
+   close();
+
+   const bool unix_socket = address.compare(0, 5, "unix:") == 0 || (!address.empty() && address[0] == '/');
+   if (unix_socket) {
+      const std::string path = address[0] == '/' ? address : address.substr(5);
+      sockaddr_un socket_address = {};
+      socket_address.sun_family = AF_UNIX;
+      if (path.empty() || path.size() >= sizeof(socket_address.sun_path)) {
+	 std::cout << "[Frame streamer]: bad socket path: " << path << std::endl;
+	 return false;
+      }
+      memcpy(socket_address.sun_path, path.c_str(), path.size() + 1);
+
+      m_ListenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);	// https://www.man7.org/linux/man-pages/man7/unix.7.html
+      if (m_ListenSocket < 0) {
+	 return socketError("socket", m_ListenSocket);
+      }
+      unlink(path.c_str()); // left over from a run that crashed
+      if (bind(m_ListenSocket, (const sockaddr*)&socket_address, sizeof(socket_address)) < 0) {
+	 return socketError(path.c_str(), m_ListenSocket);
+      }
+      m_SocketPath = path;
+   } else {
+      const int port = atoi(address.c_str());
+      if (port <= 0 || port > 65535) {
+	 std::cout << "[Frame streamer]: bad port: " << address << std::endl;
+	 return false;
+      }
+      sockaddr_in socket_address = {};
+      socket_address.sin_family = AF_INET;
+      socket_address.sin_port = htons((uint16_t)port);
+      socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // local viewers only
+
+      m_ListenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);	// https://www.man7.org/linux/man-pages/man7/tcp.7.html
+      if (m_ListenSocket < 0) {
+	 return socketError("socket", m_ListenSocket);
+      }
+      const int reuse = 1;
+      setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+      if (bind(m_ListenSocket, (const sockaddr*)&socket_address, sizeof(socket_address)) < 0) {
+	 return socketError(address.c_str(), m_ListenSocket);
+      }
+   }
+
+   if (listen(m_ListenSocket, 8) < 0) {
+      return socketError("listen", m_ListenSocket);
+   }
+   m_WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);	// https://www.man7.org/linux/man-pages/man2/eventfd.2.html
+   if (m_WakeFd < 0) {
+      return socketError("eventfd", m_ListenSocket);
+   }
+
+   for (Readback& readback : m_Readbacks) {
+      GLCall(glGenBuffers(1, &readback.buffer));
+   }
+
+   m_Stop.store(false);
+   m_Sender = std::thread(&FrameStreamer::senderLoop, this);
+   return true;
+}
+
+void FrameStreamer::close() {
+   if (m_ListenSocket < 0) {
+      return;
+   }
+
+   m_Stop.store(true);
+   const uint64_t wake = 1;
+   (void)!write(m_WakeFd, &wake, sizeof(wake));
+   m_Sender.join();
+
+   /* a running encode still publishes into the slots */
+   while (m_Encoding.load()) {
+      std::this_thread::yield();
+   }
+
+   for (size_t i = m_Clients.size(); i-- > 0;) {
+      closeClient(i);
+   }
+   ::close(m_ListenSocket);
+   ::close(m_WakeFd);
+   m_ListenSocket = -1;
+   m_WakeFd = -1;
+   if (!m_SocketPath.empty()) {
+      unlink(m_SocketPath.c_str());
+      m_SocketPath.clear();
+   }
+
+   for (Readback& readback : m_Readbacks) {
+      if (readback.fence) {
+	 glDeleteSync(readback.fence);
+      }
+      glDeleteBuffers(1, &readback.buffer);
+      readback = Readback();
+   }
+   for (FrameSlot& slot : m_Slots) {
+      slot.in_use = false;
+   }
+   m_Published = nullptr;
+   m_Current = nullptr;
+   m_PreviousWidth = m_PreviousHeight = 0;
+}
+
+///------------///
+///- READBACK -///
+///------------///
+
+void FrameStreamer::capture(unsigned int framebuffer, int width, int height) {
+   if (!isOpen() || width <= 0 || height <= 0) {
+      return;
+   }
+   poll();
+
+   /* the gpu has not even finished the copy from READBACK_COUNT frames ago */
+   Readback& readback = m_Readbacks[m_NextReadback];
+   if (readback.fence) {
+      m_FramesDropped++;
+      return;
+   }
+
+   const size_t size = (size_t)width * height * 4;
+   GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+   if (readback.capacity < size) {
+      GLCall(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));	// https://docs.gl/gl4/glBufferData
+      readback.capacity = size;
+   }
+
+   /* with a pack buffer bound this only queues the copy, nothing waits for the gpu */
+   GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+   GLCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));	// https://docs.gl/gl4/glReadPixels
+   GLCall(readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));	// https://docs.gl/gl4/glFenceSync
+   GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+   GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+   readback.width = width;
+   readback.height = height;
+   m_NextReadback = (m_NextReadback + 1) % READBACK_COUNT;
+}
+
+void FrameStreamer::poll() {
+   if (!isOpen()) {
+      return;
+   }
+
+   /* oldest first, and in order, a later copy cannot be done before an earlier one */
+   for (int k = 0; k < READBACK_COUNT; k++) {
+      Readback& readback = m_Readbacks[(m_NextReadback + k) % READBACK_COUNT];
+      if (!readback.fence) {
+	 continue;
+      }
+      GLCall(GLenum status = glClientWaitSync(readback.fence, 0, 0));	// https://docs.gl/gl4/glClientWaitSync
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+	 break;
+      }
+      GLCall(glDeleteSync(readback.fence));
+      readback.fence = 0;
+      collect(readback);
+   }
+}
+
+/* copies a finished readback into a free slot and starts encoding it */
+void FrameStreamer::collect(Readback& readback) {
+   FrameSlot* slot = nullptr;
+   if (!m_Encoding.load()) {
+      std::lock_guard<std::mutex> lock(m_SlotMutex);
+      for (FrameSlot& candidate : m_Slots) {
+	 if (!candidate.in_use) {
+	    slot = &candidate;
+	    slot->in_use = true;
+	    break;
+	 }
+      }
+   }
+   if (!slot) { // the encoder is still busy with the last one
+      m_FramesDropped++;
+      return;
+   }
+
+   const size_t size = (size_t)readback.width * readback.height * 4;
+   slot->pixels.resize(size);
+
+   GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+   GLCall(const unsigned char* mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));	// https://docs.gl/gl4/glMapBufferRange
+   if (mapped) {
+      unsigned char* pixels = slot->pixels.data();
+      const size_t blocks = m_Jobs.size();
+      const size_t block_size = (size + blocks - 1) / blocks;
+      m_Jobs.parallelFor(blocks, [&](size_t block) {
+	 const size_t begin = block * block_size;
+	 if (begin < size) {
+	    memcpy(pixels + begin, mapped + begin, std::min(block_size, size - begin));
+	 }
+      }, 1);
+      GLCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));	// https://docs.gl/gl4/glUnmapBuffer
+   }
+   GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+   if (!mapped) {
+      releaseSlot(slot);
+      m_FramesDropped++;
+      return;
+   }
+
+   slot->width = readback.width;
+   slot->height = readback.height;
+   slot->frame = m_FrameCounter++;
+
+   m_Encoding.store(true);
+   FrameStreamer* streamer = this;
+   m_Jobs.release(m_Jobs.run([streamer, slot] { streamer->encode(slot); }));
+}
+
+///------------///
+///- ENCODING -///
+///------------///
+
+/* on a worker: diff against the previous frame, compress what changed, publish */
+void FrameStreamer::encode(FrameSlot* slot) {
+   const int width = slot->width;
+   const int height = slot->height;
+   const int tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+   const size_t tile_count = (size_t)tiles_x * ((height + TILE_SIZE - 1) / TILE_SIZE);
+   slot->dirty.resize(tile_count);
+   slot->tiles.resize(tile_count);
+
+   const bool full = width != m_PreviousWidth || height != m_PreviousHeight;
+   if (full) {
+      m_Previous.resize(slot->pixels.size());
+      m_PreviousWidth = width;
+      m_PreviousHeight = height;
+   }
+
+   /* tiles cover disjoint parts of m_Previous, so each worker can update its own */
+   m_Jobs.parallelFor(tile_count, [&](size_t t) {
+      const int x0 = (int)(t % tiles_x) * TILE_SIZE;
+      const int y0 = (int)(t / tiles_x) * TILE_SIZE;
+      const int y1 = std::min(height, y0 + TILE_SIZE);
+      const size_t row_bytes = (size_t)(std::min(width, x0 + TILE_SIZE) - x0) * 4;
+
+      bool changed = full;
+      for (int y = y0; y < y1; y++) {
+	 const size_t offset = ((size_t)y * width + x0) * 4;
+	 if (full || memcmp(&m_Previous[offset], &slot->pixels[offset], row_bytes) != 0) {
+	    memcpy(&m_Previous[offset], &slot->pixels[offset], row_bytes);
+	    changed = true;
+	 }
+      }
+
+      slot->dirty[t] = changed ? 1 : 0;
+      slot->tiles[t].compressed = false;
+      if (changed) {
+	 compressTile(*slot, t);
+      }
+   });
+
+   m_FramesEncoded++;
+   publish(slot);
+   m_Encoding.store(false);
+}
+
+void FrameStreamer::compressTile(FrameSlot& slot, size_t t) {
+   const int tiles_x = (slot.width + TILE_SIZE - 1) / TILE_SIZE;
+   const int x0 = (int)(t % tiles_x) * TILE_SIZE;
+   const int y0 = (int)(t / tiles_x) * TILE_SIZE;
+   const int y1 = std::min(slot.height, y0 + TILE_SIZE);
+   const size_t row_bytes = (size_t)(std::min(slot.width, x0 + TILE_SIZE) - x0) * 4;
+
+   unsigned char gathered[TILE_BYTES];
+   size_t gathered_size = 0;
+   for (int y = y0; y < y1; y++) {
+      memcpy(gathered + gathered_size, &slot.pixels[((size_t)y * slot.width + x0) * 4], row_bytes);
+      gathered_size += row_bytes;
+   }
+
+   Tile& tile = slot.tiles[t];
+   if (tile.bytes.size() < compressBound(TILE_BYTES)) {
+      tile.bytes.resize(compressBound(TILE_BYTES));
+   }
+   tile.size = tile.bytes.size();
+   compress2(tile.bytes.data(), &tile.size, gathered, gathered_size, COMPRESSION_LEVEL);	// https://www.zlib.net/manual.html#Utility
+   tile.compressed = true;
+}
+
+void FrameStreamer::publish(FrameSlot* slot) {
+   {
+      std::lock_guard<std::mutex> lock(m_SlotMutex);
+      if (m_Published) {
+	 /* the sender never picked that one up, what changed in it is folded into this one */
+	 if (m_Published->width == slot->width && m_Published->height == slot->height) {
+	    for (size_t t = 0; t < slot->dirty.size(); t++) {
+	       slot->dirty[t] |= m_Published->dirty[t];
+	    }
+	 }
+	 m_Published->in_use = false;
+	 m_FramesDropped++;
+      }
+      m_Published = slot;
+   }
+
+   const uint64_t wake = 1;
+   (void)!write(m_WakeFd, &wake, sizeof(wake));
+}
+
+void FrameStreamer::releaseSlot(FrameSlot* slot) {
+   std::lock_guard<std::mutex> lock(m_SlotMutex);
+   slot->in_use = false;
+}
+
+///-----------///
+///- SENDING -///
+///-----------///
+
+void FrameStreamer::closeClient(size_t i) {
+   ::close(m_Clients[i].fd);
+   m_Clients.erase(m_Clients.begin() + i);
+}
+
+/* builds the client's next update from m_Current: every tile it has not seen, or all of them */
+void FrameStreamer::package(Client& client) {
+   FrameSlot& frame = *m_Current;
+   const size_t tile_count = frame.dirty.size();
+   const bool full = client.width != frame.width || client.height != frame.height;
+   if (!full && std::find(client.pending.begin(), client.pending.end(), 1) == client.pending.end()) {
+      return;
+   }
+
+   client.out.resize(sizeof(StreamFrameHeader));
+   client.sent = 0;
+   uint32_t sent_tiles = 0;
+   for (size_t t = 0; t < tile_count; t++) {
+      if (!full && !client.pending[t]) {
+	 continue;
+      }
+
+      Tile& tile = frame.tiles[t];
+      if (!tile.compressed) { // changed in a frame this client skipped, but not in this one
+	 compressTile(frame, t);
+      }
+      const uint32_t tile_header[2] = { (uint32_t)t, (uint32_t)tile.size };
+      const size_t at = client.out.size();
+      client.out.resize(at + sizeof(tile_header) + tile.size);
+      memcpy(&client.out[at], tile_header, sizeof(tile_header));
+      memcpy(&client.out[at + sizeof(tile_header)], tile.bytes.data(), tile.size);
+      sent_tiles++;
+   }
+
+   StreamFrameHeader header = { { 'S', 'V', 'F', '1' }, frame.frame, (uint32_t)frame.width, (uint32_t)frame.height, TILE_SIZE, sent_tiles };
+   memcpy(client.out.data(), &header, sizeof(header));
+
+   client.pending.assign(tile_count, 0);
+   client.width = frame.width;
+   client.height = frame.height;
+}
+
+void FrameStreamer::senderLoop() {
+   std::vector<pollfd> fds;
+   unsigned char discard[256];
+
+   while (!m_Stop.load()) {
+      fds.clear();
+      fds.push_back({ m_WakeFd, POLLIN, 0 });
+      fds.push_back({ m_ListenSocket, POLLIN, 0 });
+      for (const Client& client : m_Clients) {
+	 fds.push_back({ client.fd, (short)(POLLIN | (client.sent < client.out.size() ? POLLOUT : 0)), 0 });
+      }
+      const size_t polled_clients = m_Clients.size();
+
+      if (::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) {	// https://www.man7.org/linux/man-pages/man2/poll.2.html
+	 std::cout << "[Frame streamer]: poll: " << strerror(errno) << std::endl;
+	 return;
+      }
+
+      if (fds[0].revents & POLLIN) {
+	 uint64_t wakes;
+	 (void)!read(m_WakeFd, &wakes, sizeof(wakes));
+      }
+      if (fds[1].revents & POLLIN) {
+	 int fd;
+	 while ((fd = accept4(m_ListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+	    const int no_delay = 1;
+	    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay)); // fails harmlessly on UNIX sockets
+	    Client client;
+	    client.fd = fd;
+	    m_Clients.push_back(client);
+	 }
+      }
+
+      /* a newer frame: every client owes the tiles that changed in it */
+      FrameSlot* newest;
+      {
+	 std::lock_guard<std::mutex> lock(m_SlotMutex);
+	 newest = m_Published;
+	 m_Published = nullptr;
+      }
+      if (newest) {
+	 if (m_Current) {
+	    releaseSlot(m_Current);
+	 }
+	 m_Current = newest;
+
+	 for (Client& client : m_Clients) {
+	    if (client.sent < client.out.size()) {
+	       m_FramesDropped++; // still busy with an older update, this one gets merged into its next
+	    }
+	    if (client.width == newest->width && client.height == newest->height) {
+	       for (size_t t = 0; t < newest->dirty.size(); t++) {
+		  client.pending[t] |= newest->dirty[t];
+	       }
+	    }
+	 }
+      }
+
+      for (size_t i = m_Clients.size(); i-- > 0;) {
+	 Client& client = m_Clients[i];
+	 if (i < polled_clients) {
+	    const short events = fds[2 + i].revents;
+	    if (events & (POLLERR | POLLHUP | POLLNVAL)) {
+	       closeClient(i);
+	       continue;
+	    }
+	    if (events & POLLIN) { // viewers do not talk, this is only here to notice them leaving
+	       const ssize_t received = recv(client.fd, discard, sizeof(discard), MSG_DONTWAIT);
+	       if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		  closeClient(i);
+		  continue;
+	       }
+	    }
+	 }
+
+	 if (client.sent == client.out.size() && m_Current) {
+	    package(client);
+	 }
+
+	 bool failed = false;
+	 while (client.sent < client.out.size()) {
+	    const ssize_t sent = send(client.fd, client.out.data() + client.sent, client.out.size() - client.sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+	    if (sent > 0) {
+	       client.sent += sent;
+	       m_BytesSent += sent;
+	    } else {
+	       failed = sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+	       break;
+	    }
+	 }
+	 if (failed) {
+	    closeClient(i);
+	 }
+      }
+   }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Renderer.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h> // uint32_t
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Wire format, little-endian. Every message is one frame update:
+ *   StreamFrameHeader
+ *   tile_count times: uint32 tile index, uint32 compressed size, zlib compressed RGBA8 tile
+ * Tiles are TILE_SIZE squared, row-major from the bottom-left like glReadPixels, the ones on
+ * the right and top edge are clipped to the frame. Only tiles that changed since the last
+ * update that client got are sent, the first update after connecting or a resize has all */
+struct StreamFrameHeader {
+   char magic[4];	// "SVF1"
+   uint32_t frame;
+   uint32_t width;
+   uint32_t height;
+   uint32_t tile_size;
+   uint32_t tile_count;
+};
+
+/* Streams the rendered frame to local viewers, for renders on nodes without a display.
+ * capture() queues an async readback into a pixel buffer, a few frames later the pixels are
+ * diffed against the previous frame tile by tile and the changed tiles are compressed in
+ * parallel on the job system. A sender thread serves every client over a TCP or UNIX socket.
+ * Frames are dropped instead of queued whenever something falls behind: the gpu readback, the
+ * encoder, or a single slow client. A client that missed frames gets the tiles it missed
+ * merged into its next update, so nothing ever shows stale. */
+class FrameStreamer {
+public:
+   static const int TILE_SIZE = 64;
+
+private:
+   static const int READBACK_COUNT = 3;
+   static const int SLOT_COUNT = 3; // one encoding, one published, one being sent
+
+   struct Readback {
+      unsigned int buffer = 0;
+      size_t capacity = 0;
+      GLsync fence = 0;
+      int width = 0;
+      int height = 0;
+   };
+
+   struct Tile {
+      std::vector<unsigned char> bytes;
+      unsigned long size = 0;	// compressed
+      bool compressed = false;
+   };
+
+   struct FrameSlot {
+      std::vector<unsigned char> pixels;
+      std::vector<unsigned char> dirty;	// per tile
+      std::vector<Tile> tiles;
+      int width = 0;
+      int height = 0;
+      uint32_t frame = 0;
+      bool in_use = false;
+   };
+
+   struct Client {
+      int fd = -1;
+      std::vector<unsigned char> out;	// the update being sent
+      size_t sent = 0;
+      std::vector<unsigned char> pending;	// tiles it has not seen yet
+      int width = 0;
+      int height = 0;
+   };
+
+   JobSystem& m_Jobs;
+
+   /* render thread */
+   Readback m_Readbacks[READBACK_COUNT];
+   int m_NextReadback;	// also the oldest one still pending
+   uint32_t m_FrameCounter;
+
+   /* encoder, one frame at a time */
+   FrameSlot m_Slots[SLOT_COUNT];
+   std::vector<unsigned char> m_Previous;
+   int m_PreviousWidth, m_PreviousHeight;
+   std::atomic<bool> m_Encoding;
+
+   /* hand-off to the sender */
+   std::mutex m_SlotMutex;
+   FrameSlot* m_Published;
+
+   /* sender thread */
+   std::thread m_Sender;
+   std::atomic<bool> m_Stop;
+   int m_ListenSocket;
+   int m_WakeFd;
+   std::string m_SocketPath;	// unlinked on close, UNIX sockets only
+   std::vector<Client> m_Clients;
+   FrameSlot* m_Current;	// newest frame the sender has, updates are built from it
+
+   std::atomic<size_t> m_FramesEncoded;
+   std::atomic<size_t> m_FramesDropped;
+   std::atomic<size_t> m_BytesSent;
+
+   void collect(Readback& readback);
+   void encode(FrameSlot* slot);
+   void compressTile(FrameSlot& slot, size_t tile);
+   void publish(FrameSlot* slot);
+   void releaseSlot(FrameSlot* slot);
+
+   void senderLoop();
+   void package(Client& client);
+   void closeClient(size_t i);
+
+public:
+   explicit FrameStreamer(JobSystem& jobs);
+   ~FrameStreamer();
+
+   FrameStreamer(const FrameStreamer&) = delete;
+   FrameStreamer& operator=(const FrameStreamer&) = delete;
+
+   /* "unix:/path" or a path starting with '/' listens on a UNIX socket, anything else is a
+    * TCP port bound to 127.0.0.1. GL thread, with a context current */
+   bool open(const std::string& address);
+   /* stops the sender and deletes the pixel buffers, same thread as open */
+   void close();
+
+   /* starts reading back the lower-left width x height of framebuffer, right after drawing */
+   void capture(unsigned int framebuffer, int width, int height);
+   /* hands readbacks the gpu has finished to the encoder, call every loop even when not drawing */
+   void poll();
+
+   bool isOpen() const { return m_ListenSocket >= 0; }
+   size_t framesEncoded() const { return m_FramesEncoded.load(); }
+   size_t framesDropped() const { return m_FramesDropped.load(); }
+   size_t bytesSent() const { return m_BytesSent.load(); }
+};
@@ -0,0 +1,191 @@
+#include "GpuResources.h"
+
+#include <iostream> // input/output stream
+
+static const char* const TYPE_NAMES[GPU_RESOURCE_TYPES] = { "buffers", "textures", "renderbuffers", "programs" };
+
+GpuResources::GpuResources()
+   : m_Frame(0), m_ReleasedThisFrame(false) {
+}
+
+/* no GL here, the context may already be gone. finish() is the place for that */
+GpuResources::~GpuResources() {
+   if (!m_Pending.empty()) {
+      std::cout << "[GPU resources]: " << m_Pending.size() << " objects never deleted, finish() was not called" << std::endl;
+   }
+}
+
+GpuHandleId GpuResources::adopt(GpuResourceType type, unsigned int name, size_t bytes) {
+   GpuHandleId id;
+   if (!m_FreeSlots.empty()) {
+      id.index = m_FreeSlots.back();
+      m_FreeSlots.pop_back();
+   } else {
+      id.index = (uint32_t)m_Slots.size();
+      m_Slots.push_back({ 0, 0, type, 0 });
+   }
+
+   Slot& slot = m_Slots[id.index];
+   slot.name = name;
+   slot.generation++; // odd while live, even while free
+   slot.type = type;
+   slot.bytes = bytes;
+   id.generation = slot.generation;
+
+   m_Stats[type].live++;
+   m_Stats[type].bytes += bytes;
+   return id;
+}
+
+void GpuResources::release(GpuHandleId id) {
+   if (name(id) == 0) {
+      return;
+   }
+
+   Slot& slot = m_Slots[id.index];
+   m_Stats[slot.type].live--;
+   m_Stats[slot.type].bytes -= slot.bytes;
+   m_Stats[slot.type].pending++;
+   m_Pending.push_back({ slot.type, slot.name, m_Frame });
+   m_ReleasedThisFrame = true;
+
+   slot.name = 0;
+   slot.generation++;
+   m_FreeSlots.push_back(id.index);
+}
+
+unsigned int GpuResources::name(GpuHandleId id) const {
+   if (id.index >= m_Slots.size() || m_Slots[id.index].generation != id.generation) {
+      return 0;
+   }
+   return m_Slots[id.index].name;
+}
+
+void GpuResources::setBytes(GpuHandleId id, size_t bytes) {
+   if (name(id) == 0) {
+      return;
+   }
+
+   Slot& slot = m_Slots[id.index];
+   m_Stats[slot.type].bytes += bytes;
+   m_Stats[slot.type].bytes -= slot.bytes;
+   slot.bytes = bytes;
+}
+
+BufferHandle GpuResources::createBuffer(GLenum target, size_t bytes, const void* data, GLenum usage) {
+   unsigned int buffer;
+   GLCall(glGenBuffers(1, &buffer));	// https://docs.gl/gl4/glGenBuffers
+   GLCall(glBindBuffer(target, buffer));	// https://docs.gl/gl4/glBindBuffer
+   GLCall(glBufferData(target, bytes, data, usage));	// https://docs.gl/gl4/glBufferData
+   return BufferHandle(*this, adopt(GPU_BUFFER, buffer, bytes));
+}
+
+TextureHandle GpuResources::createTexture() {
+   unsigned int texture;
+   GLCall(glGenTextures(1, &texture));	// https://docs.gl/gl4/glGenTextures
+   return TextureHandle(*this, adopt(GPU_TEXTURE, texture));
+}
+
+RenderbufferHandle GpuResources::createRenderbuffer() {
+   unsigned int renderbuffer;
+   GLCall(glGenRenderbuffers(1, &renderbuffer));	// https://docs.gl/gl4/glGenRenderbuffers
+   return RenderbufferHandle(*this, adopt(GPU_RENDERBUFFER, renderbuffer));
+}
+
+ProgramHandle GpuResources::createProgram(const ShaderProgramSource& source) {
+   return ProgramHandle(*this, adopt(GPU_PROGRAM, createShader(source.VertexSource, source.FragmentSource)));
+}
+
+/* deletes the oldest count pending objects, one glDelete call per type */
+void GpuResources::deletePending(size_t count) {
+   for (unsigned int type = 0; type < GPU_RESOURCE_TYPES; type++) {
+      m_DeleteBatch.clear();
+      for (size_t i = 0; i < count; i++) {
+	 if (m_Pending[i].type == type) {
+	    m_DeleteBatch.push_back(m_Pending[i].name);
+	 }
+      }
+      if (m_DeleteBatch.empty()) {
+	 continue;
+      }
+
+      const GLsizei n = (GLsizei)m_DeleteBatch.size();
+      switch (type) {
+      case GPU_BUFFER:
+	 GLCall(glDeleteBuffers(n, m_DeleteBatch.data()));	// https://docs.gl/gl4/glDeleteBuffers
+	 break;
+      case GPU_TEXTURE:
+	 GLCall(glDeleteTextures(n, m_DeleteBatch.data()));	// https://docs.gl/gl4/glDeleteTextures
+	 break;
+      case GPU_RENDERBUFFER:
+	 GLCall(glDeleteRenderbuffers(n, m_DeleteBatch.data()));	// https://docs.gl/gl4/glDeleteRenderbuffers
+	 break;
+      case GPU_PROGRAM: // no batched form
+	 for (unsigned int program : m_DeleteBatch) {
+	    GLCall(glDeleteProgram(program));	// https://docs.gl/gl4/glDeleteProgram
+	 }
+	 break;
+      }
+      m_Stats[type].pending -= m_DeleteBatch.size();
+   }
+
+   m_Pending.erase(m_Pending.begin(), m_Pending.begin() + count);
+}
+
+void GpuResources::endFrame() {
+   /* everything released so far is covered by a fence after this frame's commands.
+    * Sync objects are shared, the fence goes into the current context, which after
+    * ViewSet::drawAll is the primary, the last one to submit */
+   if (m_ReleasedThisFrame) {
+      GLCall(GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));	// https://docs.gl/gl4/glFenceSync
+      m_Fences.push_back({ fence, m_Frame });
+      m_ReleasedThisFrame = false;
+   }
+   m_Frame++;
+
+   /* fences signal in order, stop at the first one still running */
+   size_t signaled = 0;
+   size_t completed_frame = 0;
+   while (signaled < m_Fences.size()) {
+      GLCall(GLenum status = glClientWaitSync(m_Fences[signaled].fence, 0, 0));	// https://docs.gl/gl4/glClientWaitSync
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+	 break;
+      }
+      GLCall(glDeleteSync(m_Fences[signaled].fence));	// https://docs.gl/gl4/glDeleteSync
+      completed_frame = m_Fences[signaled].frame;
+      signaled++;
+   }
+   if (signaled == 0) {
+      return;
+   }
+   m_Fences.erase(m_Fences.begin(), m_Fences.begin() + signaled);
+
+   size_t count = 0;
+   while (count < m_Pending.size() && m_Pending[count].frame <= completed_frame) {
+      count++;
+   }
+   deletePending(count);
+}
+
+void GpuResources::finish() {
+   GLCall(glFinish());	// https://docs.gl/gl4/glFinish
+   for (const FrameFence& frame_fence : m_Fences) {
+      GLCall(glDeleteSync(frame_fence.fence));
+   }
+   m_Fences.clear();
+   m_ReleasedThisFrame = false;
+   deletePending(m_Pending.size());
+
+   for (unsigned int type = 0; type < GPU_RESOURCE_TYPES; type++) {
+      if (m_Stats[type].live > 0) {
+	 std::cout << "[GPU resources]: " << m_Stats[type].live << " " << TYPE_NAMES[type] << " still alive (" << m_Stats[type].bytes << " bytes)" << std::endl;
+      }
+   }
+}
+
+void GpuResources::printStats() const {
+   for (unsigned int type = 0; type < GPU_RESOURCE_TYPES; type++) {
+      std::cout << "[GPU resources]: " << TYPE_NAMES[type] << ": " << m_Stats[type].live << " live, "
+		<< m_Stats[type].bytes << " bytes, " << m_Stats[type].pending << " pending delete" << std::endl;
+   }
+}
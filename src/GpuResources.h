@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Renderer.h"
+
+#include <stdint.h> // uint32_t
+#include <vector>
+
+/* kinds of GL object the table owns. VAOs and FBOs are per context and stay with their users */
+enum GpuResourceType : unsigned int {
+   GPU_BUFFER = 0,
+   GPU_TEXTURE,
+   GPU_RENDERBUFFER,
+   GPU_PROGRAM,
+   GPU_RESOURCE_TYPES,
+};
+
+/* slot index plus the generation it was handed out with, generation 0 is never live */
+struct GpuHandleId {
+   uint32_t index = 0;
+   uint32_t generation = 0;
+};
+
+struct GpuResourceStats {
+   size_t live = 0;	// created and not released
+   size_t bytes = 0;	// as declared at creation / setBytes, live objects only
+   size_t pending = 0;	// released, waiting for the gpu before the actual glDelete
+};
+
+template<GpuResourceType Type> class GpuHandle;
+using BufferHandle = GpuHandle<GPU_BUFFER>;
+using TextureHandle = GpuHandle<GPU_TEXTURE>;
+using RenderbufferHandle = GpuHandle<GPU_RENDERBUFFER>;
+using ProgramHandle = GpuHandle<GPU_PROGRAM>;
+
+/* Owns GL objects through a generational table, a stale handle resolves to 0 instead of to
+ * whatever object reused the slot. Released objects are not deleted right away: endFrame()
+ * fences the frame that released them and deletes them in one batch per type once that fence
+ * has signaled, so a draw still in flight never loses its buffer and the driver never has
+ * to stall for a glDelete in the middle of a frame. GL thread only. */
+class GpuResources {
+private:
+   struct Slot {
+      unsigned int name;
+      uint32_t generation;
+      GpuResourceType type;
+      size_t bytes;
+   };
+
+   struct PendingDelete {
+      GpuResourceType type;
+      unsigned int name;
+      size_t frame;	// frame it was released in
+   };
+
+   struct FrameFence {
+      GLsync fence;
+      size_t frame;
+   };
+
+   std::vector<Slot> m_Slots;
+   std::vector<uint32_t> m_FreeSlots;
+   std::vector<PendingDelete> m_Pending;	// in release order, so also in frame order
+   std::vector<FrameFence> m_Fences;	// oldest first
+   std::vector<unsigned int> m_DeleteBatch;	// reused by deletePending
+   GpuResourceStats m_Stats[GPU_RESOURCE_TYPES];
+   size_t m_Frame;
+   bool m_ReleasedThisFrame;
+
+   void deletePending(size_t count);
+
+public:
+   GpuResources();
+   ~GpuResources();
+
+   GpuResources(const GpuResources&) = delete;
+   GpuResources& operator=(const GpuResources&) = delete;
+
+   /* takes ownership of an existing object */
+   GpuHandleId adopt(GpuResourceType type, unsigned int name, size_t bytes = 0);
+   /* queues the object for deletion, the id is invalid immediately */
+   void release(GpuHandleId id);
+
+   unsigned int name(GpuHandleId id) const;
+   /* after re-specifying storage, keeps the byte counts honest */
+   void setBytes(GpuHandleId id, size_t bytes);
+
+   /* generates a buffer, fills it and leaves it bound to target */
+   BufferHandle createBuffer(GLenum target, size_t bytes, const void* data, GLenum usage);
+   TextureHandle createTexture();
+   RenderbufferHandle createRenderbuffer();
+   ProgramHandle createProgram(const ShaderProgramSource& source);
+
+   /* call once per frame after the swap: fences this frame's releases and deletes what the gpu is done with */
+   void endFrame();
+   /* waits for the gpu and deletes everything pending, before the context goes away */
+   void finish();
+
+   const GpuResourceStats& stats(GpuResourceType type) const { return m_Stats[type]; }
+   void printStats() const;
+};
+
+/* Move-only owner of one object in a GpuResources table, releases it when destroyed */
+template<GpuResourceType Type>
+class GpuHandle {
+private:
+   GpuResources* m_Resources;
+   GpuHandleId m_Id;
+
+public:
+   GpuHandle() : m_Resources(nullptr) {}
+   GpuHandle(GpuResources& resources, GpuHandleId id) : m_Resources(&resources), m_Id(id) {}
+   ~GpuHandle() { reset(); }
+
+   GpuHandle(const GpuHandle&) = delete;
+   GpuHandle& operator=(const GpuHandle&) = delete;
+
+   GpuHandle(GpuHandle&& other) : m_Resources(other.m_Resources), m_Id(other.m_Id) {
+      other.m_Resources = nullptr;
+   }
+   GpuHandle& operator=(GpuHandle&& other) {
+      if (this != &other) {
+	 reset();
+	 m_Resources = other.m_Resources;
+	 m_Id = other.m_Id;
+	 other.m_Resources = nullptr;
+      }
+      return *this;
+   }
+
+   /* the GL name, 0 when empty */
+   unsigned int get() const { return m_Resources ? m_Resources->name(m_Id) : 0; }
+   explicit operator bool() const { return get() != 0; }
+
+   void setBytes(size_t bytes) { if (m_Resources) m_Resources->setBytes(m_Id, bytes); }
+
+   void reset() {
+      if (m_Resources) {
+	 m_Resources->release(m_Id);
+	 m_Resources = nullptr;
+      }
+   }
+};
@@ -0,0 +1,304 @@
+#include "JobSystem.h"
+#include "Renderer.h"
+
+#include <algorithm> // std::max, std::min
+
+/* which queue this thread pushes to, for the one system it is a worker of */
+static thread_local JobSystem* worker_system = nullptr;
+static thread_local unsigned int worker_index = 0;
+static thread_local unsigned int steal_seed = 0x9E3779B9u;
+
+JobSystem::JobSystem(unsigned int thread_count, size_t job_capacity)
+   : m_Jobs(job_capacity), m_Queued(0), m_Sleeping(0), m_Stop(false) {
+   if (thread_count == 0) {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+   }
+
+   size_t ring_size = 1;
+   while (ring_size < job_capacity) {
+      ring_size <<= 1;
+   }
+   m_QueueMask = ring_size - 1;
+
+   m_Queues = std::vector<WorkQueue>(thread_count); // thread_count - 1 workers, plus the shared one
+   for (WorkQueue& queue : m_Queues) {
+      queue.ring.resize(ring_size);
+   }
+
+   m_FreeJobs.reserve(job_capacity);
+   for (size_t i = job_capacity; i-- > 0;) {
+      m_FreeJobs.push_back(&m_Jobs[i]);
+   }
+
+   for (unsigned int i = 1; i < thread_count; i++) { // the caller is thread 0
+      m_Workers.emplace_back(&JobSystem::workerLoop, this, i - 1);
+   }
+}
+
+JobSystem::~JobSystem() {
+   {
+      std::lock_guard<std::mutex> lock(m_SleepMutex);
+      m_Stop = true;
+   }
+   m_WorkReady.notify_all();
+
+   for (std::thread& worker : m_Workers) {
+      worker.join();
+   }
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+   worker_system = this;
+   worker_index = index;
+   steal_seed += index * 0x85EBCA6Bu;
+
+   while (true) {
+      Job* job = findJob();
+      if (job) {
+	 execute(job);
+	 continue;
+      }
+
+      /* m_Sleeping goes up before m_Queued is checked, push() reads them the other way round,
+       * so either the pusher sees a sleeper to wake or the sleeper sees the job */
+      std::unique_lock<std::mutex> lock(m_SleepMutex);
+      m_Sleeping.fetch_add(1);
+      m_WorkReady.wait(lock, [&] { return m_Stop || m_Queued.load() > 0; });
+      m_Sleeping.fetch_sub(1);
+      if (m_Stop) {
+	 return;
+      }
+   }
+}
+
+///------------///
+///- THE POOL -///
+///------------///
+
+Job* JobSystem::allocate() {
+   Job* job;
+   {
+      std::lock_guard<std::mutex> lock(m_FreeMutex);
+      if (m_FreeJobs.empty()) {
+	 return nullptr;
+      }
+      job = m_FreeJobs.back();
+      m_FreeJobs.pop_back();
+   }
+
+   job->parent = nullptr;
+   job->pending.store(1);
+   job->unfinished.store(1);
+   job->references.store(1);
+   job->finished.store(false);
+   job->continuation_count = 0;
+   return job;
+}
+
+void JobSystem::releaseJob(Job* job) {
+   if (job->references.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(m_FreeMutex);
+      m_FreeJobs.push_back(job);
+   }
+}
+
+void JobSystem::addDependency(Job* job, JobHandle prerequisite) {
+   if (!prerequisite) {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock(prerequisite->continuation_mutex);
+   if (prerequisite->finished.load()) {
+      return;
+   }
+   ASSERT(prerequisite->continuation_count < Job::MAX_CONTINUATIONS);
+   prerequisite->continuations[prerequisite->continuation_count++] = job;
+   job->pending.fetch_add(1);
+}
+
+/* drops the submission hold, the job is queued now unless prerequisites are still running */
+void JobSystem::submit(Job* job) {
+   if (job->pending.fetch_sub(1) == 1) {
+      push(job);
+   }
+}
+
+///--------------------///
+///- QUEUES, STEALING -///
+///--------------------///
+
+JobSystem::WorkQueue& JobSystem::localQueue() {
+   return worker_system == this ? m_Queues[worker_index] : m_Queues.back();
+}
+
+void JobSystem::push(Job* job) {
+   WorkQueue& queue = localQueue();
+   {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      const size_t tail = queue.tail.load();
+      queue.ring[tail & m_QueueMask] = job;
+      queue.tail.store(tail + 1);
+   }
+
+   m_Queued.fetch_add(1);
+   if (m_Sleeping.load() > 0) {
+      {
+	 std::lock_guard<std::mutex> lock(m_SleepMutex);
+      }
+      m_WorkReady.notify_one();
+   }
+}
+
+/* own queue from the back (newest, still warm in cache), then everyone else's from the front */
+Job* JobSystem::findJob() {
+   WorkQueue& own = localQueue();
+   {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      const size_t tail = own.tail.load();
+      if (tail != own.head.load()) {
+	 own.tail.store(tail - 1);
+	 m_Queued.fetch_sub(1);
+	 return own.ring[(tail - 1) & m_QueueMask];
+      }
+   }
+
+   steal_seed ^= steal_seed << 13;
+   steal_seed ^= steal_seed >> 17;
+   steal_seed ^= steal_seed << 5;
+   const size_t queue_count = m_Queues.size();
+   const size_t start = steal_seed % queue_count;
+   for (size_t k = 0; k < queue_count; k++) {
+      WorkQueue& victim = m_Queues[(start + k) % queue_count];
+      if (&victim == &own || victim.head.load() == victim.tail.load()) {
+	 continue;
+      }
+
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      const size_t head = victim.head.load();
+      if (head != victim.tail.load()) {
+	 victim.head.store(head + 1);
+	 m_Queued.fetch_sub(1);
+	 return victim.ring[head & m_QueueMask];
+      }
+   }
+   return nullptr;
+}
+
+void JobSystem::execute(Job* job) {
+   job->function(*this, *job);
+   finishJob(job);
+}
+
+/* once a job and all its children are done: wake its continuations and tell its parent */
+void JobSystem::finishJob(Job* job) {
+   if (job->unfinished.fetch_sub(1) != 1) {
+      return;
+   }
+
+   Job* ready[Job::MAX_CONTINUATIONS];
+   int ready_count;
+   {
+      std::lock_guard<std::mutex> lock(job->continuation_mutex);
+      job->finished.store(true);
+      ready_count = job->continuation_count;
+      std::copy(job->continuations, job->continuations + ready_count, ready);
+      job->continuation_count = 0;
+   }
+   for (int i = 0; i < ready_count; i++) {
+      submit(ready[i]);
+   }
+
+   Job* parent = job->parent;
+   releaseJob(job);
+   if (parent) {
+      finishJob(parent);
+   }
+}
+
+void JobSystem::helpUntil(Job* job) {
+   if (!job) {
+      return;
+   }
+   while (!job->finished.load()) {
+      Job* other = findJob();
+      if (other) {
+	 execute(other);
+      } else {
+	 std::this_thread::yield();
+      }
+   }
+}
+
+void JobSystem::wait(JobHandle job) {
+   if (!job) {
+      return;
+   }
+   helpUntil(job);
+   releaseJob(job);
+}
+
+void JobSystem::release(JobHandle job) {
+   if (job) {
+      releaseJob(job);
+   }
+}
+
+///----------------///
+///- PARALLEL FOR -///
+///----------------///
+
+void JobSystem::forRange(size_t count, size_t min_chunk, void (*invoke)(void* body, size_t i), void* body) {
+   if (count == 0) {
+      return;
+   }
+
+   /* about 8 chunks per thread if nobody says otherwise, enough to even out uneven work */
+   const size_t grain = std::max<size_t>(1, min_chunk ? min_chunk : count / (size() * 8));
+   Job* root = (count > grain && !m_Workers.empty()) ? allocate() : nullptr;
+   if (!root) {
+      for (size_t i = 0; i < count; i++) {
+	 invoke(body, i);
+      }
+      return;
+   }
+
+   new (root->storage) RangeTask{ invoke, body, 0, count, grain };
+   root->function = runRange;
+   root->references.store(2); // this call waits on it
+
+   /* the caller starts on the whole range itself, the halves it splits off are what the workers steal */
+   execute(root);
+   wait(root);
+}
+
+/* Lazy binary splitting: work through the range a grain at a time, and whenever this thread's
+ * queue has run empty (everything offered was stolen) hand off the back half of what is left */
+void JobSystem::runRange(JobSystem& jobs, Job& job) {
+   const RangeTask& range = *(const RangeTask*)job.storage;
+   Job* root = job.parent ? job.parent : &job;
+   WorkQueue& local = jobs.localQueue();
+
+   size_t begin = range.begin;
+   size_t end = range.end;
+   while (begin < end) {
+      if (end - begin > 2 * range.grain && local.head.load() == local.tail.load()) {
+	 Job* child = jobs.allocate();
+	 if (child) {
+	    const size_t middle = begin + (end - begin) / 2;
+	    new (child->storage) RangeTask{ range.invoke, range.body, middle, end, range.grain };
+	    child->function = runRange;
+	    child->parent = root;
+	    root->unfinished.fetch_add(1);
+	    jobs.submit(child);
+	    end = middle;
+	    continue;
+	 }
+      }
+
+      const size_t chunk_end = std::min(end, begin + range.grain);
+      for (size_t i = begin; i < chunk_end; i++) {
+	 range.invoke(range.body, i);
+      }
+      begin = chunk_end;
+   }
+}
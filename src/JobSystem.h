@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <new> // placement new
+#include <stddef.h> // size_t
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class JobSystem;
+
+/* One unit of work. They live in JobSystem's fixed pool, user code only ever holds JobHandles */
+struct Job {
+   static const size_t STORAGE_BYTES = 64;
+   static const int MAX_CONTINUATIONS = 8;
+
+   void (*function)(JobSystem& jobs, Job& job);
+   alignas(16) unsigned char storage[STORAGE_BYTES];	// the task itself, or a parallelFor range
+   Job* parent;				// the parallelFor whose join this counts towards
+
+   std::atomic<int> pending;		// submission hold plus unfinished prerequisites, queued at 0
+   std::atomic<int> unfinished;		// itself plus unfinished children
+   std::atomic<int> references;		// the system until done, the handle until waited on
+   std::atomic<bool> finished;
+
+   std::mutex continuation_mutex;
+   Job* continuations[MAX_CONTINUATIONS];	// waiting on this one
+   int continuation_count;
+};
+
+/* nullptr is a job that already finished */
+using JobHandle = Job*;
+
+/* Work-stealing scheduler for the CPU side: decimation, culling, sorting, colormaps,
+ * decompression. Every worker owns a deque, it pushes and pops at the back and idle workers
+ * steal from the front, so work spreads out without a shared queue everyone fights over.
+ * Threads that are not workers (main, the render thread, ...) can submit and wait too, they
+ * go through one extra shared queue and help run jobs while they wait.
+ * Jobs come from a pool allocated up front, nothing is allocated per job. When the pool runs
+ * dry a job simply runs right away on the thread that submitted it. */
+class JobSystem {
+private:
+   struct alignas(64) WorkQueue {
+      std::mutex mutex;
+      std::vector<Job*> ring;	// can hold every job in the pool, so never overflows
+      std::atomic<size_t> head{ 0 };	// stolen from
+      std::atomic<size_t> tail{ 0 };	// pushed and popped by the owner
+   };
+
+   /* a parallelFor's remaining index range, kept in Job::storage */
+   struct RangeTask {
+      void (*invoke)(void* body, size_t i);
+      void* body;
+      size_t begin;
+      size_t end;
+      size_t grain;
+   };
+
+   std::vector<std::thread> m_Workers;
+   std::vector<WorkQueue> m_Queues;	// one per worker, the last is shared by everyone else
+   size_t m_QueueMask;
+
+   std::vector<Job> m_Jobs;
+   std::vector<Job*> m_FreeJobs;
+   std::mutex m_FreeMutex;
+
+   std::atomic<size_t> m_Queued;	// jobs sitting in any queue
+   std::atomic<unsigned int> m_Sleeping;
+   std::mutex m_SleepMutex;
+   std::condition_variable m_WorkReady;
+   bool m_Stop;
+
+   void workerLoop(unsigned int index);
+
+   WorkQueue& localQueue();
+   Job* allocate();
+   void releaseJob(Job* job);
+   void addDependency(Job* job, JobHandle prerequisite);
+   void submit(Job* job);
+   void push(Job* job);
+   Job* findJob();
+   void execute(Job* job);
+   void finishJob(Job* job);
+   /* runs other jobs until job is done */
+   void helpUntil(Job* job);
+
+   void forRange(size_t count, size_t min_chunk, void (*invoke)(void* body, size_t i), void* body);
+   static void runRange(JobSystem& jobs, Job& job);
+
+public:
+   /* thread_count includes the calling thread, 0 picks one per hardware thread */
+   explicit JobSystem(unsigned int thread_count = 0, size_t job_capacity = 4096);
+   ~JobSystem();
+
+   JobSystem(const JobSystem&) = delete;
+   JobSystem& operator=(const JobSystem&) = delete;
+
+   /* threads that run jobs, counting the one waiting */
+   unsigned int size() const { return (unsigned int)m_Workers.size() + 1; }
+
+   /* Queues task() to run once every job in after has finished. The task is copied into the
+    * job, so it has to be small and trivially copyable: capture references or a pointer.
+    * The handle has to go to wait() or release() */
+   template<typename Task>
+   JobHandle run(Task&& task, std::initializer_list<JobHandle> after = {}) {
+      using Callable = typename std::decay<Task>::type;
+      static_assert(sizeof(Callable) <= Job::STORAGE_BYTES, "job task too large, capture a pointer to a struct instead");
+      static_assert(std::is_trivially_copyable<Callable>::value, "job tasks are copied as plain bytes");
+
+      Job* job = allocate();
+      if (!job) {
+	 for (JobHandle prerequisite : after) {
+	    helpUntil(prerequisite);
+	 }
+	 task();
+	 return nullptr;
+      }
+
+      new (job->storage) Callable(task);
+      job->function = [](JobSystem&, Job& self) { (*(Callable*)self.storage)(); };
+      job->references.store(2);
+      for (JobHandle prerequisite : after) {
+	 addDependency(job, prerequisite);
+      }
+      submit(job);
+      return job;
+   }
+
+   /* blocks until the job is done, running other jobs meanwhile, and gives the handle back */
+   void wait(JobHandle job);
+   /* gives the handle back without waiting, the job still runs */
+   void release(JobHandle job);
+
+   /* body(i) for every i below count, returns once all ran. Ranges are split in half only while
+    * other workers are hungry for work, down to min_chunk indices (0 picks it from count).
+    * body is only referenced, never copied */
+   template<typename Body>
+   void parallelFor(size_t count, Body&& body, size_t min_chunk = 0) {
+      using Callable = typename std::remove_reference<Body>::type;
+      forRange(count, min_chunk, [](void* callable, size_t i) { (*(Callable*)callable)(i); }, (void*)&body);
+   }
+};
@@ -0,0 +1,67 @@
+#include "MappedFile.h"
+
+#include <iostream> // input/output stream
+#include <algorithm> // std::min
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, madvise
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, sysconf
+
+MappedFile::MappedFile()
+   : m_File(-1), m_Data(nullptr), m_Size(0) {
+}
+
+MappedFile::~MappedFile() {
+   close();
+}
+
+bool MappedFile::open(const std::string& filePath) {
+   close();
+
+   m_File = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);	// https://www.man7.org/linux/man-pages/man2/open.2.html
+   if (m_File < 0) {
+      std::cout << "File not open " << filePath << std::endl;
+      return false;
+   }
+
+   struct stat info;
+   if (fstat(m_File, &info) != 0 || info.st_size == 0) {
+      std::cout << "File empty or unreadable " << filePath << std::endl;
+      close();
+      return false;
+   }
+
+   void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, m_File, 0);	// https://www.man7.org/linux/man-pages/man2/mmap.2.html
+   if (mapping == MAP_FAILED) {
+      std::cout << "File not mapped " << filePath << std::endl;
+      close();
+      return false;
+   }
+
+   m_Data = (const unsigned char*)mapping;
+   m_Size = info.st_size;
+   return true;
+}
+
+void MappedFile::close() {
+   if (m_Data) {
+      munmap((void*)m_Data, m_Size);
+      m_Data = nullptr;
+      m_Size = 0;
+   }
+   if (m_File >= 0) {
+      ::close(m_File);
+      m_File = -1;
+   }
+}
+
+void MappedFile::advise(size_t offset, size_t length, int advice) const {
+   if (!m_Data || offset >= m_Size || length == 0) {
+      return;
+   }
+
+   static const size_t page_size = sysconf(_SC_PAGESIZE);
+   const size_t begin = offset / page_size * page_size;
+   const size_t end = std::min(m_Size, offset + length);
+   madvise((void*)(m_Data + begin), end - begin, advice);	// https://www.man7.org/linux/man-pages/man2/madvise.2.html
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <string> // strings!
+
+/* Read-only memory mapping of a whole file. Pages are loaded by the kernel on first touch,
+ * so mapping a file much larger than RAM is fine as long as it is not all touched at once */
+class MappedFile {
+private:
+   int m_File;
+   const unsigned char* m_Data;
+   size_t m_Size;
+
+public:
+   MappedFile();
+   ~MappedFile();
+
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   bool open(const std::string& filePath);
+   void close();
+
+   /* madvise over [offset, offset + length), widened to whole pages */
+   void advise(size_t offset, size_t length, int advice) const;
+
+   bool isOpen() const { return m_Data != nullptr; }
+   const unsigned char* data() const { return m_Data; }
+   size_t size() const { return m_Size; }
+};
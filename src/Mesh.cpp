@@ -0,0 +1,417 @@
+#include "Mesh.h"
+
+#include <math.h> // math
+#include <string.h> // memcpy
+#include <algorithm> // std::min, std::max
+
+///----------------------///
+///- VERTEX CACHE ORDER -///
+///----------------------///
+
+/* Forsyth's tuning constants, a 32 entry LRU model is a good fit for current hardware */
+static const int CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+static const unsigned int VALENCE_TABLE_SIZE = 32;
+
+struct ScoreTables {
+   float cache[CACHE_SIZE];
+   float valence[VALENCE_TABLE_SIZE];
+
+   ScoreTables() {
+      for (int i = 0; i < CACHE_SIZE; i++) {
+	 if (i < 3) {
+	    cache[i] = LAST_TRIANGLE_SCORE; // the last triangle's vertices, don't favour any order
+	 } else {
+	    cache[i] = powf(1.0f - (float)(i - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	 }
+      }
+      valence[0] = 0.0f;
+      for (unsigned int i = 1; i < VALENCE_TABLE_SIZE; i++) {
+	 valence[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER);
+      }
+   }
+};
+
+static float vertexScore(const ScoreTables& tables, int cache_position, unsigned int live_triangles) {
+   if (live_triangles == 0) {
+      return -1.0f; // nothing left to draw with this vertex
+   }
+
+   float score = cache_position >= 0 ? tables.cache[cache_position] : 0.0f;
+   if (live_triangles < VALENCE_TABLE_SIZE) {
+      score += tables.valence[live_triangles];
+   } else {
+      score += VALENCE_BOOST_SCALE * powf((float)live_triangles, -VALENCE_BOOST_POWER);
+   }
+   return score;
+}
+
+void optimizeVertexCache(unsigned int* indices, size_t index_count, unsigned int vertex_count) {
+   static const ScoreTables tables;
+
+   const size_t triangle_count = index_count / 3;
+   if (triangle_count == 0) {
+      return;
+   }
+
+   /* vertex -> triangles adjacency, packed. live_triangles shrinks as triangles are emitted */
+   std::vector<unsigned int> live_triangles(vertex_count, 0);
+   for (size_t i = 0; i < triangle_count * 3; i++) {
+      live_triangles[indices[i]]++;
+   }
+
+   std::vector<size_t> adjacency_offset(vertex_count + 1, 0);
+   for (unsigned int v = 0; v < vertex_count; v++) {
+      adjacency_offset[v + 1] = adjacency_offset[v] + live_triangles[v];
+   }
+
+   std::vector<unsigned int> adjacency(triangle_count * 3);
+   {
+      std::vector<size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+      for (size_t t = 0; t < triangle_count; t++) {
+	 for (int k = 0; k < 3; k++) {
+	    adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+	 }
+      }
+   }
+
+   std::vector<int> cache_position(vertex_count, -1);
+   std::vector<float> vertex_score(vertex_count);
+   for (unsigned int v = 0; v < vertex_count; v++) {
+      vertex_score[v] = vertexScore(tables, -1, live_triangles[v]);
+   }
+
+   std::vector<float> triangle_score(triangle_count);
+   std::vector<bool> emitted(triangle_count, false);
+   size_t best_triangle = 0;
+   for (size_t t = 0; t < triangle_count; t++) {
+      triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+      if (triangle_score[t] > triangle_score[best_triangle]) {
+	 best_triangle = t;
+      }
+   }
+
+   std::vector<unsigned int> output(triangle_count * 3);
+   unsigned int cache[CACHE_SIZE + 3];
+   unsigned int next_cache[CACHE_SIZE + 3];
+   int cache_count = 0;
+   size_t dead_end_cursor = 0; // triangles before this one are all emitted
+
+   for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+      if (best_triangle == (size_t)-1) {
+	 /* nothing in the cache has triangles left, continue with the next unemitted one in input order */
+	 while (emitted[dead_end_cursor]) {
+	    dead_end_cursor++;
+	 }
+	 best_triangle = dead_end_cursor;
+      }
+
+      const unsigned int* triangle = &indices[best_triangle * 3];
+      memcpy(&output[emitted_count * 3], triangle, 3 * sizeof(unsigned int));
+      emitted[best_triangle] = true;
+
+      /* take the triangle out of its vertices' live lists */
+      for (int k = 0; k < 3; k++) {
+	 const unsigned int v = triangle[k];
+	 unsigned int* first = &adjacency[adjacency_offset[v]];
+	 unsigned int* last = first + live_triangles[v] - 1;
+	 for (unsigned int* it = first; it <= last; it++) {
+	    if (*it == best_triangle) {
+	       *it = *last;
+	       break;
+	    }
+	 }
+	 live_triangles[v]--;
+      }
+
+      /* LRU update: the triangle's vertices move to the front */
+      int next_count = 0;
+      for (int k = 0; k < 3; k++) {
+	 next_cache[next_count++] = triangle[k];
+      }
+      for (int i = 0; i < cache_count; i++) {
+	 const unsigned int v = cache[i];
+	 if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+	    next_cache[next_count++] = v;
+	 }
+      }
+
+      /* rescore everything that was or is in the cache, vertices past CACHE_SIZE just fell out */
+      for (int i = 0; i < next_count; i++) {
+	 const unsigned int v = next_cache[i];
+	 cache_position[v] = i < CACHE_SIZE ? i : -1;
+
+	 const float score = vertexScore(tables, cache_position[v], live_triangles[v]);
+	 const float delta = score - vertex_score[v];
+	 vertex_score[v] = score;
+
+	 const unsigned int* adjacent = &adjacency[adjacency_offset[v]];
+	 for (unsigned int j = 0; j < live_triangles[v]; j++) {
+	    triangle_score[adjacent[j]] += delta;
+	 }
+      }
+
+      /* the next triangle is the best one touching the cache */
+      best_triangle = (size_t)-1;
+      float best_score = -1.0f;
+      cache_count = std::min(next_count, CACHE_SIZE);
+      for (int i = 0; i < cache_count; i++) {
+	 const unsigned int v = next_cache[i];
+	 cache[i] = v;
+
+	 const unsigned int* adjacent = &adjacency[adjacency_offset[v]];
+	 for (unsigned int j = 0; j < live_triangles[v]; j++) {
+	    if (triangle_score[adjacent[j]] > best_score) {
+	       best_score = triangle_score[adjacent[j]];
+	       best_triangle = adjacent[j];
+	    }
+	 }
+      }
+   }
+
+   memcpy(indices, output.data(), triangle_count * 3 * sizeof(unsigned int));
+}
+
+void optimizeVertexFetch(std::vector<MeshVertex>& vertices, unsigned int* indices, size_t index_count) {
+   const unsigned int UNUSED = ~0u;
+   std::vector<unsigned int> remap(vertices.size(), UNUSED);
+   std::vector<MeshVertex> reordered;
+   reordered.reserve(vertices.size());
+
+   for (size_t i = 0; i < index_count; i++) {
+      unsigned int& target = remap[indices[i]];
+      if (target == UNUSED) {
+	 target = (unsigned int)reordered.size();
+	 reordered.push_back(vertices[indices[i]]);
+      }
+      indices[i] = target;
+   }
+
+   vertices.swap(reordered);
+}
+
+float averageCacheMissRatio(const unsigned int* indices, size_t index_count, unsigned int cache_size) {
+   if (index_count < 3) {
+      return 0.0f;
+   }
+
+   /* FIFO, which is closer to real post-transform caches than LRU */
+   std::vector<unsigned int> fifo(cache_size, ~0u);
+   size_t head = 0;
+   size_t misses = 0;
+   for (size_t i = 0; i < index_count; i++) {
+      if (std::find(fifo.begin(), fifo.end(), indices[i]) == fifo.end()) {
+	 fifo[head] = indices[i];
+	 head = (head + 1) % cache_size;
+	 misses++;
+      }
+   }
+   return (float)misses / (index_count / 3);
+}
+
+///----------///
+///-  MESH  -///
+///----------///
+
+/* 16-bit chunks may span at most this many vertices, 0xFFFF is kept free as the restart index */
+static const unsigned int MAX_SHORT_SPAN = 0xFFFE;
+
+Mesh::Mesh(const std::string& shaderFilePath)
+   : m_VertexArray([this] {
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer));
+	GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer));	// element binding is part of the vao
+	applyVertexLayout<MeshVertex>();
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+     }),
+     m_Mode(GL_TRIANGLES), m_IndexCount(0), m_IndexBytes(0) {
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+   m_Shader = createShader(source.VertexSource, source.FragmentSource);
+   checkVertexInputs<MeshVertex>(m_Shader, "MeshVertex");
+
+   GLCall(m_MVPLocation = glGetUniformLocation(m_Shader, "u_MVP"));
+   GLCall(m_ColorLocation = glGetUniformLocation(m_Shader, "u_Color"));
+   GLCall(m_LightLocation = glGetUniformLocation(m_Shader, "u_LightDirection"));
+
+   GLCall(glGenBuffers(1, &m_VertexBuffer));
+   GLCall(glGenBuffers(1, &m_IndexBuffer));
+}
+
+Mesh::~Mesh() {
+   glDeleteBuffers(1, &m_VertexBuffer);
+   glDeleteBuffers(1, &m_IndexBuffer);
+   glDeleteProgram(m_Shader);
+}
+
+void Mesh::setTriangles(std::vector<MeshVertex> vertices, std::vector<unsigned int> indices) {
+   indices.resize(indices.size() - indices.size() % 3);
+   optimizeVertexCache(indices.data(), indices.size(), (unsigned int)vertices.size());
+   optimizeVertexFetch(vertices, indices.data(), indices.size());
+
+   std::vector<size_t> triangle_ends(indices.size() / 3);
+   for (size_t t = 0; t < triangle_ends.size(); t++) {
+      triangle_ends[t] = (t + 1) * 3;
+   }
+
+   m_Mode = GL_TRIANGLES;
+   upload(vertices, indices, triangle_ends);
+}
+
+void Mesh::setStrips(std::vector<MeshVertex> vertices, const std::vector<std::vector<unsigned int>>& strips) {
+   std::vector<unsigned int> indices;
+   std::vector<size_t> strip_ends;
+   for (const std::vector<unsigned int>& strip : strips) {
+      if (strip.size() < 3) {
+	 continue;
+      }
+      indices.insert(indices.end(), strip.begin(), strip.end());
+      strip_ends.push_back(indices.size());
+   }
+
+   /* strips are already cache friendly by construction, only the fetch order needs fixing */
+   optimizeVertexFetch(vertices, indices.data(), indices.size());
+
+   m_Mode = GL_TRIANGLE_STRIP;
+   upload(vertices, indices, strip_ends);
+}
+
+void Mesh::upload(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices,
+		  const std::vector<size_t>& primitive_ends) {
+   const bool strips = m_Mode == GL_TRIANGLE_STRIP;
+
+   m_ChunkCounts.clear();
+   m_ChunkOffsets.clear();
+   m_ChunkBaseVertices.clear();
+   m_ChunkRuns.clear();
+
+   std::vector<unsigned char> index_data;
+   index_data.reserve(indices.size() * sizeof(unsigned short));
+
+   /* Greedily grow a chunk primitive by primitive while its vertex span fits in 16 bits.
+    * After optimizeVertexFetch vertices are numbered in draw order, so spans stay small
+    * and almost everything ends up 16-bit. Primitives that alone span more go to 32-bit chunks. */
+   size_t primitive = 0;
+   size_t primitive_begin = 0;
+   while (primitive < primitive_ends.size()) {
+      const size_t chunk_begin = primitive_begin;
+      unsigned int chunk_min = ~0u, chunk_max = 0;
+      bool wide = false;
+      size_t chunk_end = chunk_begin;
+      size_t chunk_primitives = 0;
+
+      while (primitive < primitive_ends.size()) {
+	 const size_t end = primitive_ends[primitive];
+	 unsigned int prim_min = ~0u, prim_max = 0;
+	 for (size_t i = primitive_begin; i < end; i++) {
+	    prim_min = std::min(prim_min, indices[i]);
+	    prim_max = std::max(prim_max, indices[i]);
+	 }
+	 const bool prim_wide = prim_max - prim_min > MAX_SHORT_SPAN;
+	 const unsigned int new_min = std::min(chunk_min, prim_min);
+	 const unsigned int new_max = std::max(chunk_max, prim_max);
+
+	 if (chunk_primitives > 0 && (prim_wide != wide || (!wide && new_max - new_min > MAX_SHORT_SPAN))) {
+	    break;
+	 }
+
+	 wide = prim_wide;
+	 chunk_min = new_min;
+	 chunk_max = new_max;
+	 chunk_end = end;
+	 chunk_primitives++;
+	 primitive_begin = end;
+	 primitive++;
+      }
+
+      /* write the chunk, strips inside it are separated by the restart index */
+      const GLenum index_type = wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+      const size_t index_size = wide ? sizeof(unsigned int) : sizeof(unsigned short);
+      const unsigned int base = wide ? 0 : chunk_min;
+
+      index_data.resize((index_data.size() + index_size - 1) / index_size * index_size); // keep alignment
+      const size_t offset = index_data.size();
+
+      size_t written = 0;
+      size_t strip_end_index = primitive - chunk_primitives;
+      for (size_t i = chunk_begin; i < chunk_end; i++) {
+	 if (strips && i > chunk_begin && i == primitive_ends[strip_end_index]) {
+	    const unsigned int restart = wide ? 0xFFFFFFFFu : 0xFFFFu;
+	    index_data.insert(index_data.end(), (const unsigned char*)&restart, (const unsigned char*)&restart + index_size);
+	    strip_end_index++;
+	    written++;
+	 }
+	 const unsigned int value = indices[i] - base;
+	 if (wide) {
+	    index_data.insert(index_data.end(), (const unsigned char*)&value, (const unsigned char*)&value + index_size);
+	 } else {
+	    const unsigned short narrow = (unsigned short)value;
+	    index_data.insert(index_data.end(), (const unsigned char*)&narrow, (const unsigned char*)&narrow + index_size);
+	 }
+	 written++;
+      }
+
+      if (m_ChunkRuns.empty() || m_ChunkRuns.back().index_type != index_type) {
+	 m_ChunkRuns.push_back({ index_type, m_ChunkCounts.size(), 0 });
+      }
+      m_ChunkRuns.back().chunk_count++;
+
+      m_ChunkCounts.push_back((GLsizei)written);
+      m_ChunkOffsets.push_back((const void*)offset);
+      m_ChunkBaseVertices.push_back((GLint)base);
+   }
+
+   m_IndexCount = indices.size();
+   m_IndexBytes = index_data.size();
+
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer));
+   GLCall(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MeshVertex), vertices.data(), GL_STATIC_DRAW));
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+   /* not through GL_ELEMENT_ARRAY_BUFFER, that would change whichever vao is bound */
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_IndexBuffer));
+   GLCall(glBufferData(GL_COPY_WRITE_BUFFER, index_data.size(), index_data.data(), GL_STATIC_DRAW));
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void Mesh::draw(const float* mvp) {
+   if (m_ChunkCounts.empty()) {
+      return;
+   }
+
+   GLCall(glUseProgram(m_Shader));
+   GLCall(glUniformMatrix4fv(m_MVPLocation, 1, GL_FALSE, mvp));	// https://docs.gl/gl4/glUniform
+   GLCall(glUniform4fv(m_ColorLocation, 1, color));
+   GLCall(glUniform3fv(m_LightLocation, 1, light_direction));
+
+   /* chunks come in cache order, not back to front, only the depth test keeps them apart */
+   GLboolean depth_testing;
+   GLCall(glGetBooleanv(GL_DEPTH_TEST, &depth_testing));
+   GLCall(glEnable(GL_DEPTH_TEST));	// https://docs.gl/gl4/glEnable
+   GLCall(glDepthFunc(GL_LESS));	// https://docs.gl/gl4/glDepthFunc
+
+   m_VertexArray.bind();
+   if (m_Mode == GL_TRIANGLE_STRIP) {
+      GLCall(glEnable(GL_PRIMITIVE_RESTART));				// https://docs.gl/gl4/glPrimitiveRestartIndex
+   }
+
+   for (const ChunkRun& run : m_ChunkRuns) {
+      if (m_Mode == GL_TRIANGLE_STRIP) {
+	 /* compared against the index before the base vertex is added */
+	 GLCall(glPrimitiveRestartIndex(run.index_type == GL_UNSIGNED_SHORT ? 0xFFFFu : 0xFFFFFFFFu));
+      }
+      GLCall(glMultiDrawElementsBaseVertex(m_Mode, &m_ChunkCounts[run.first_chunk], run.index_type,	// https://docs.gl/gl4/glMultiDrawElementsBaseVertex
+					   &m_ChunkOffsets[run.first_chunk], run.chunk_count,
+					   &m_ChunkBaseVertices[run.first_chunk]));
+   }
+
+   if (m_Mode == GL_TRIANGLE_STRIP) {
+      GLCall(glDisable(GL_PRIMITIVE_RESTART));
+   }
+   GLCall(glBindVertexArray(0));
+
+   if (!depth_testing) {
+      GLCall(glDisable(GL_DEPTH_TEST));
+   }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Views.h"
+#include "VertexLayout.h"
+
+#include <vector>
+
+struct MeshVertex {
+   float x, y, z;
+   float nx, ny, nz;
+};
+
+template<> struct VertexFormat<MeshVertex> {
+   static constexpr VertexAttribute attributes[] = {
+      VERTEX_ATTRIBUTE_RUN(MeshVertex, x, z, 0, "vertex_position", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE_RUN(MeshVertex, nx, nz, 1, "vertex_normal", ATTRIBUTE_FLOAT),
+   };
+};
+
+/* Reorders triangles (in place) for the post-transform vertex cache, Forsyth's
+ * linear-speed algorithm: https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html */
+void optimizeVertexCache(unsigned int* indices, size_t index_count, unsigned int vertex_count);
+
+/* Renumbers vertices in the order the indices first reference them, so neighbouring
+ * triangles also use neighbouring vertices. Unreferenced vertices are dropped. */
+void optimizeVertexFetch(std::vector<MeshVertex>& vertices, unsigned int* indices, size_t index_count);
+
+/* Average cache miss ratio (vertex shader runs per triangle) of a FIFO cache, 0.5 is the best possible */
+float averageCacheMissRatio(const unsigned int* indices, size_t index_count, unsigned int cache_size = 32);
+
+/* Triangle or strip mesh for FEM and surface output. The index buffer is split into chunks
+ * that each span less than 64k vertices, those are stored as 16-bit indices relative to
+ * a base vertex and drawn with glDrawElementsBaseVertex, only the rest pays for 32 bits. */
+class Mesh {
+private:
+   /* consecutive chunks with the same index type go out in one glMultiDrawElementsBaseVertex */
+   struct ChunkRun {
+      GLenum index_type;	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+      size_t first_chunk;
+      GLsizei chunk_count;
+   };
+
+   ContextVertexArray m_VertexArray;
+   unsigned int m_VertexBuffer;
+   unsigned int m_IndexBuffer;
+   unsigned int m_Shader;
+
+   int m_MVPLocation;
+   int m_ColorLocation;
+   int m_LightLocation;
+
+   GLenum m_Mode;		// GL_TRIANGLES or GL_TRIANGLE_STRIP
+   std::vector<GLsizei> m_ChunkCounts;
+   std::vector<const void*> m_ChunkOffsets;	// byte offsets into the index buffer
+   std::vector<GLint> m_ChunkBaseVertices;
+   std::vector<ChunkRun> m_ChunkRuns;
+   size_t m_IndexCount;
+   size_t m_IndexBytes;
+
+   void upload(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices,
+	       const std::vector<size_t>& primitive_ends);
+
+public:
+   float color[4] = { 0.8f, 0.8f, 0.85f, 1.0f };
+   float light_direction[3] = { 0.0f, 0.0f, 1.0f };
+
+   Mesh(const std::string& shaderFilePath = "../res/shaders/mesh.shader");
+   ~Mesh();
+
+   Mesh(const Mesh&) = delete;
+   Mesh& operator=(const Mesh&) = delete;
+
+   /* indexed triangle list, vertex cache and fetch order are optimized before upload */
+   void setTriangles(std::vector<MeshVertex> vertices, std::vector<unsigned int> indices);
+
+   /* triangle strips, joined with primitive restart inside each chunk */
+   void setStrips(std::vector<MeshVertex> vertices, const std::vector<std::vector<unsigned int>>& strips);
+   /* mvp is a column-major 4x4 matrix. Depth tested with GL_LESS, leaves depth testing as it was */
+   /* mvp is a column-major 4x4 matrix */
+   void draw(const float* mvp);
+
+   size_t indexBytes() const { return m_IndexBytes; }		// what the index buffer actually costs
+   size_t indexCount() const { return m_IndexCount; }		// indexCount() * 4 is what 32-bit indices would cost
+   size_t chunkCount() const { return m_ChunkCounts.size(); }
+};
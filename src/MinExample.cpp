@@ -1,4 +1,9 @@
 #include <GLFW/glfw3.h>
+static bool damaged = true;
+static void refresh(GLFWwindow* window) {
+   (void)window;
+   damaged = true;
+}
 int main(void) {
    GLFWwindow* window;
    if(!glfwInit())
@@ -9,8 +14,13 @@ int main(void) {
       return 0;
    }
    glfwMakeContextCurrent(window);
+   glfwSetWindowRefreshCallback(window, refresh);
    while (!glfwWindowShouldClose(window)) {
-      glfwSwapBuffers(window);
+      if (damaged) {
+	 glfwSwapBuffers(window);
+	 damaged = false;
+      }
+      glfwWaitEvents();
    }
    glfwTerminate();
    return 0;
@@ -0,0 +1,280 @@
+#include "OffsetAllocator.h"
+
+static const uint32_t MANTISSA_BITS = 3;
+static const uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+static const uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+static inline uint32_t highestBit(uint32_t value) { return 31 - __builtin_clz(value); }
+static inline uint32_t lowestBit(uint32_t value) { return __builtin_ctz(value); }
+
+/* smallest bin whose every size is >= size, where allocations look */
+static uint32_t binRoundUp(uint32_t size) {
+   if (size < MANTISSA_VALUE) {
+      return size; // denormals, one bin per size
+   }
+   const uint32_t mantissa_start = highestBit(size) - MANTISSA_BITS;
+   const uint32_t exponent = mantissa_start + 1;
+   uint32_t mantissa = (size >> mantissa_start) & MANTISSA_MASK;
+   if (size & ((1u << mantissa_start) - 1)) {
+      mantissa++; // may carry into the exponent, which is the right bin then
+   }
+   return (exponent << MANTISSA_BITS) + mantissa;
+}
+
+/* largest bin whose sizes are all <= size, where free blocks are filed */
+static uint32_t binRoundDown(uint32_t size) {
+   if (size < MANTISSA_VALUE) {
+      return size;
+   }
+   const uint32_t mantissa_start = highestBit(size) - MANTISSA_BITS;
+   return ((mantissa_start + 1) << MANTISSA_BITS) | ((size >> mantissa_start) & MANTISSA_MASK);
+}
+
+/* smallest size in a bin */
+static uint32_t binSize(uint32_t bin) {
+   const uint32_t exponent = bin >> MANTISSA_BITS;
+   const uint32_t mantissa = bin & MANTISSA_MASK;
+   return exponent == 0 ? mantissa : (mantissa | MANTISSA_VALUE) << (exponent - 1);
+}
+
+OffsetAllocator::OffsetAllocator(uint32_t size, uint32_t max_allocations)
+   : m_Size(size) {
+   m_Nodes.resize(max_allocations);
+   m_FreeNodes.reserve(max_allocations);
+   reset();
+}
+
+void OffsetAllocator::reset() {
+   resetPacked(nullptr, 0, nullptr);
+}
+
+void OffsetAllocator::resetPacked(const uint32_t* sizes, uint32_t count, Allocation* allocations) {
+   m_FreeStorage = 0;
+   m_UsedBinsTop = 0;
+   for (uint32_t i = 0; i < TOP_BINS; i++) {
+      m_UsedBins[i] = 0;
+   }
+   for (uint32_t i = 0; i < TOP_BINS * LEAF_BINS; i++) {
+      m_BinHeads[i] = NONE;
+   }
+
+   m_FreeNodes.clear();
+   for (uint32_t i = (uint32_t)m_Nodes.size(); i-- > 0;) {
+      m_FreeNodes.push_back(i); // node 0 on top
+   }
+
+   /* used blocks never sit in a bin, only their neighbour links matter */
+   ASSERT(count < m_Nodes.size());
+   uint32_t offset = 0;
+   uint32_t previous = NONE;
+   for (uint32_t i = 0; i < count; i++) {
+      const uint32_t node = m_FreeNodes.back();
+      m_FreeNodes.pop_back();
+      m_Nodes[node] = { offset, sizes[i], NONE, NONE, previous, NONE, true };
+      if (previous != NONE) {
+	 m_Nodes[previous].neighbor_next = node;
+      }
+      allocations[i].offset = offset;
+      allocations[i].node = node;
+      offset += sizes[i];
+      previous = node;
+   }
+   ASSERT(offset <= m_Size);
+
+   m_LastNode = previous;
+   if (offset < m_Size) {
+      m_LastNode = insertNode(offset, m_Size - offset);
+      m_Nodes[m_LastNode].neighbor_prev = previous;
+      if (previous != NONE) {
+	 m_Nodes[previous].neighbor_next = m_LastNode;
+      }
+   }
+}
+
+/* files a free block in its bin, neighbours are up to the caller */
+uint32_t OffsetAllocator::insertNode(uint32_t offset, uint32_t size) {
+   const uint32_t bin = binRoundDown(size);
+   const uint32_t top = bin >> MANTISSA_BITS;
+   const uint32_t leaf = bin & MANTISSA_MASK;
+
+   if (m_BinHeads[bin] == NONE) {
+      m_UsedBins[top] |= 1 << leaf;
+      m_UsedBinsTop |= 1u << top;
+   }
+
+   const uint32_t node = m_FreeNodes.back();
+   m_FreeNodes.pop_back();
+   m_Nodes[node] = { offset, size, NONE, m_BinHeads[bin], NONE, NONE, false };
+   if (m_BinHeads[bin] != NONE) {
+      m_Nodes[m_BinHeads[bin]].bin_prev = node;
+   }
+   m_BinHeads[bin] = node;
+
+   m_FreeStorage += size;
+   return node;
+}
+
+/* takes a free block out of its bin and gives the node slot back */
+void OffsetAllocator::removeNode(uint32_t node) {
+   const Node& n = m_Nodes[node];
+   if (n.bin_prev != NONE) {
+      m_Nodes[n.bin_prev].bin_next = n.bin_next;
+   } else {
+      const uint32_t bin = binRoundDown(n.size);
+      m_BinHeads[bin] = n.bin_next;
+      if (n.bin_next == NONE) {
+	 const uint32_t top = bin >> MANTISSA_BITS;
+	 m_UsedBins[top] &= ~(1 << (bin & MANTISSA_MASK));
+	 if (m_UsedBins[top] == 0) {
+	    m_UsedBinsTop &= ~(1u << top);
+	 }
+      }
+   }
+   if (n.bin_next != NONE) {
+      m_Nodes[n.bin_next].bin_prev = n.bin_prev;
+   }
+
+   m_FreeStorage -= n.size;
+   m_FreeNodes.push_back(node);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size) {
+   Allocation allocation;
+   if (size == 0 || m_FreeNodes.empty()) {
+      return allocation; // a split needs a spare node, keep it simple and require one
+   }
+
+   /* first non-empty bin at or above the rounded up one: the rest of its leaf mask first,
+    * then the lowest leaf of the next used top bin */
+   const uint32_t min_bin = binRoundUp(size);
+   uint32_t top = min_bin >> MANTISSA_BITS;
+   if (top >= TOP_BINS) {
+      return allocation;
+   }
+   uint32_t leaves = m_UsedBins[top] & (0xFFu << (min_bin & MANTISSA_MASK));
+   if (leaves == 0) {
+      const uint32_t tops = top + 1 < TOP_BINS ? m_UsedBinsTop & (~0u << (top + 1)) : 0;
+      if (tops == 0) {
+	 return allocation;
+      }
+      top = lowestBit(tops);
+      leaves = m_UsedBins[top];
+   }
+   const uint32_t bin = (top << MANTISSA_BITS) | lowestBit(leaves);
+
+   const uint32_t node = m_BinHeads[bin];
+   const uint32_t node_offset = m_Nodes[node].offset;
+   const uint32_t node_size = m_Nodes[node].size;
+   const uint32_t neighbor_prev = m_Nodes[node].neighbor_prev;
+   const uint32_t neighbor_next = m_Nodes[node].neighbor_next;
+   removeNode(node);
+
+   /* the node slot was just pushed back on the free stack, take it again as the used block */
+   m_FreeNodes.pop_back();
+   m_Nodes[node] = { node_offset, size, NONE, NONE, neighbor_prev, neighbor_next, true };
+
+   if (node_size > size) {
+      const uint32_t remainder = insertNode(node_offset + size, node_size - size);
+      m_Nodes[remainder].neighbor_prev = node;
+      m_Nodes[remainder].neighbor_next = neighbor_next;
+      if (neighbor_next != NONE) {
+	 m_Nodes[neighbor_next].neighbor_prev = remainder;
+      } else {
+	 m_LastNode = remainder;
+      }
+      m_Nodes[node].neighbor_next = remainder;
+   }
+
+   allocation.offset = node_offset;
+   allocation.node = node;
+   return allocation;
+}
+
+void OffsetAllocator::free(Allocation allocation) {
+   if (allocation.node == NONE) {
+      return;
+   }
+
+   Node& n = m_Nodes[allocation.node];
+   ASSERT(n.used);
+   uint32_t offset = n.offset;
+   uint32_t size = n.size;
+   uint32_t neighbor_prev = n.neighbor_prev;
+   uint32_t neighbor_next = n.neighbor_next;
+   const bool was_last = m_LastNode == allocation.node;
+   m_FreeNodes.push_back(allocation.node);
+
+   if (neighbor_prev != NONE && !m_Nodes[neighbor_prev].used) {
+      const Node& prev = m_Nodes[neighbor_prev];
+      offset = prev.offset;
+      size += prev.size;
+      const uint32_t before = prev.neighbor_prev;
+      removeNode(neighbor_prev);
+      neighbor_prev = before;
+   }
+   bool is_last = was_last;
+   if (neighbor_next != NONE && !m_Nodes[neighbor_next].used) {
+      const Node& next = m_Nodes[neighbor_next];
+      size += next.size;
+      const uint32_t after = next.neighbor_next;
+      is_last = m_LastNode == neighbor_next;
+      removeNode(neighbor_next);
+      neighbor_next = after;
+   }
+
+   const uint32_t merged = insertNode(offset, size);
+   m_Nodes[merged].neighbor_prev = neighbor_prev;
+   m_Nodes[merged].neighbor_next = neighbor_next;
+   if (neighbor_prev != NONE) {
+      m_Nodes[neighbor_prev].neighbor_next = merged;
+   }
+   if (neighbor_next != NONE) {
+      m_Nodes[neighbor_next].neighbor_prev = merged;
+   }
+   if (is_last) {
+      m_LastNode = merged;
+   }
+}
+
+void OffsetAllocator::grow(uint32_t size) {
+   if (size <= m_Size) {
+      return;
+   }
+   uint32_t offset = m_Size;
+   uint32_t extra = size - m_Size;
+   uint32_t neighbor_prev = m_LastNode;
+   m_Size = size;
+
+   if (neighbor_prev != NONE && !m_Nodes[neighbor_prev].used) {
+      offset = m_Nodes[neighbor_prev].offset;
+      extra += m_Nodes[neighbor_prev].size;
+      const uint32_t before = m_Nodes[neighbor_prev].neighbor_prev;
+      removeNode(neighbor_prev);
+      neighbor_prev = before;
+   }
+
+   m_LastNode = insertNode(offset, extra);
+   m_Nodes[m_LastNode].neighbor_prev = neighbor_prev;
+   if (neighbor_prev != NONE) {
+      m_Nodes[neighbor_prev].neighbor_next = m_LastNode;
+   }
+}
+
+uint32_t OffsetAllocator::tailFree() const {
+   if (m_LastNode == NONE || m_Nodes[m_LastNode].used) {
+      return 0;
+   }
+   return m_Nodes[m_LastNode].size;
+}
+
+uint32_t OffsetAllocator::fitSize(uint32_t size) {
+   return binSize(binRoundUp(size));
+}
+
+uint32_t OffsetAllocator::largestFree() const {
+   if (m_UsedBinsTop == 0) {
+      return 0;
+   }
+   const uint32_t top = highestBit(m_UsedBinsTop);
+   return binSize((top << MANTISSA_BITS) | highestBit(m_UsedBins[top]));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Renderer.h"
+
+#include <stdint.h> // uint32_t, uint8_t
+#include <vector>
+
+/* Two-level segregated fit allocator over an abstract range of units, it never touches the
+ * memory itself. Free blocks sit in 256 size bins, a small float of 5 exponent and 3 mantissa
+ * bits, so a bin's sizes are within 12.5% of each other. Two bitmaps find the first bin that
+ * is large enough in a couple of bit scans: allocate and free are O(1), free merges with the
+ * neighbouring blocks right away. Based on Sebastian Aaltonen's OffsetAllocator:
+ * https://github.com/sebbbi/OffsetAllocator */
+class OffsetAllocator {
+public:
+   static const uint32_t NO_SPACE = 0xFFFFFFFF;
+
+   struct Allocation {
+      uint32_t offset = NO_SPACE;
+      uint32_t node = NO_SPACE;
+   };
+
+private:
+   static const uint32_t TOP_BINS = 32;
+   static const uint32_t LEAF_BINS = 8;
+   static const uint32_t NONE = 0xFFFFFFFF;
+
+   struct Node {
+      uint32_t offset;
+      uint32_t size;
+      uint32_t bin_prev;	// free nodes of the same bin
+      uint32_t bin_next;
+      uint32_t neighbor_prev;	// the blocks right before and after in the range, used or not
+      uint32_t neighbor_next;
+      bool used;
+   };
+
+   uint32_t m_Size;
+   uint32_t m_FreeStorage;
+   uint32_t m_UsedBinsTop;
+   uint8_t m_UsedBins[TOP_BINS];
+   uint32_t m_BinHeads[TOP_BINS * LEAF_BINS];
+
+   std::vector<Node> m_Nodes;
+   std::vector<uint32_t> m_FreeNodes;	// stack of unused node slots
+   uint32_t m_LastNode;			// the block that ends the range
+
+   uint32_t insertNode(uint32_t offset, uint32_t size);
+   void removeNode(uint32_t node);
+
+public:
+   /* max_allocations bounds the live allocations plus the free blocks between them */
+   explicit OffsetAllocator(uint32_t size, uint32_t max_allocations = 64 * 1024);
+
+   Allocation allocate(uint32_t size);
+   void free(Allocation allocation);
+
+   /* extends the range at the end, merging with a free block that ends it */
+   void grow(uint32_t size);
+   /* forgets every allocation */
+   void reset();
+   /* forgets every allocation and lays count new ones out back to back from offset 0, the rest
+    * of the range one free block after them. Needs count + 1 nodes */
+   void resetPacked(const uint32_t* sizes, uint32_t count, Allocation* allocations);
+
+   uint32_t allocationSize(Allocation allocation) const { return m_Nodes[allocation.node].size; }
+   uint32_t size() const { return m_Size; }
+   uint32_t freeStorage() const { return m_FreeStorage; }
+   /* lower bound, the largest bin in use rounded down */
+   uint32_t largestFree() const;
+   /* the free block that ends the range, 0 if the range ends in an allocation */
+   uint32_t tailFree() const;
+
+   /* Free blocks are found by bin, rounded up, so a block of exactly size can be passed over.
+    * A free block of fitSize(size) is always found */
+   static uint32_t fitSize(uint32_t size);
+};
@@ -0,0 +1,147 @@
+#include "ParticleStore.h"
+#include "VertexLayout.h"
+
+#include <stdlib.h> // aligned_alloc, free
+#include <string.h> // memcpy, memset
+#include <algorithm> // std::max, std::min
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const size_t COLUMN_ALIGNMENT = 64;	// one cache line
+static_assert(ParticleStore::BLOCK_PARTICLES * sizeof(float) % COLUMN_ALIGNMENT == 0, "blocks have to start on a cache line");
+
+ParticleStore::ParticleStore()
+   : m_Count(0), m_Capacity(0), m_BufferCapacity(0), m_DirtyColumns(0), m_UploadedBytes(0) {
+   for (unsigned int c = 0; c < PARTICLE_COLUMNS; c++) {
+      m_Columns[c] = nullptr;
+   }
+   GLCall(glGenBuffers(PARTICLE_COLUMNS, m_Buffers));
+}
+
+ParticleStore::~ParticleStore() {
+   glDeleteBuffers(PARTICLE_COLUMNS, m_Buffers);
+   for (unsigned int c = 0; c < PARTICLE_COLUMNS; c++) {
+      free(m_Columns[c]);
+   }
+}
+
+void ParticleStore::grow(size_t capacity) {
+   capacity = (capacity + BLOCK_PARTICLES - 1) / BLOCK_PARTICLES * BLOCK_PARTICLES;
+   for (unsigned int c = 0; c < PARTICLE_COLUMNS; c++) {
+      unsigned char* column = (unsigned char*)aligned_alloc(COLUMN_ALIGNMENT, capacity * sizeof(float));
+      if (m_Columns[c]) {
+	 memcpy(column, m_Columns[c], m_Capacity * sizeof(float));
+	 free(m_Columns[c]);
+      }
+      memset(column + m_Capacity * sizeof(float), 0, (capacity - m_Capacity) * sizeof(float));
+      m_Columns[c] = column;
+   }
+   m_Capacity = capacity;
+}
+
+void ParticleStore::reserve(size_t capacity) {
+   if (capacity > m_Capacity) {
+      grow(capacity);
+   }
+}
+
+size_t ParticleStore::add(size_t count) {
+   if (m_Count + count > m_Capacity) {
+      grow(std::max(m_Count + count, m_Capacity + m_Capacity / 2));
+   }
+   /* slots past m_Count are always zero, remove() and clear() keep them that way */
+   const size_t first = m_Count;
+   m_Count += count;
+   m_DirtyColumns = (1u << PARTICLE_COLUMNS) - 1;
+   return first;
+}
+
+void ParticleStore::remove(size_t i) {
+   const size_t last = --m_Count;
+   for (unsigned int c = 0; c < PARTICLE_COLUMNS; c++) {
+      float* column = (float*)m_Columns[c];
+      memcpy(&column[i], &column[last], sizeof(float)); // color indices are copied as bits
+      column[last] = 0.0f;
+   }
+   m_DirtyColumns = (1u << PARTICLE_COLUMNS) - 1;
+}
+
+void ParticleStore::clear() {
+   for (unsigned int c = 0; c < PARTICLE_COLUMNS; c++) {
+      if (m_Columns[c]) {
+	 memset(m_Columns[c], 0, m_Count * sizeof(float));
+      }
+   }
+   m_Count = 0;
+   m_DirtyColumns = 0;
+}
+
+/* one block of one axis, always the whole block: the padding past the last particle is
+ * zero velocity so it stays zero, and the loop needs no scalar tail */
+static void integrateBlock(float* position, const float* velocity, float dt) {
+#if defined(__SSE2__)
+   const __m128 dt4 = _mm_set1_ps(dt);
+   for (size_t i = 0; i < ParticleStore::BLOCK_PARTICLES; i += 4) {
+      _mm_store_ps(position + i, _mm_add_ps(_mm_load_ps(position + i), _mm_mul_ps(_mm_load_ps(velocity + i), dt4)));
+   }
+#else
+   for (size_t i = 0; i < ParticleStore::BLOCK_PARTICLES; i++) {
+      position[i] += velocity[i] * dt;
+   }
+#endif
+}
+
+void ParticleStore::integrate(JobSystem& jobs, float dt) {
+   float* x = column(PARTICLE_X);
+   float* y = column(PARTICLE_Y);
+   float* z = column(PARTICLE_Z);
+   const float* vx = (const float*)m_Columns[PARTICLE_VX];
+   const float* vy = (const float*)m_Columns[PARTICLE_VY];
+   const float* vz = (const float*)m_Columns[PARTICLE_VZ];
+
+   jobs.parallelFor(blockCount(), [&](size_t block) {
+      const size_t first = block * BLOCK_PARTICLES;
+      integrateBlock(x + first, vx + first, dt);
+      integrateBlock(y + first, vy + first, dt);
+      integrateBlock(z + first, vz + first, dt);
+   }, 1);
+}
+
+void ParticleStore::upload() {
+   m_UploadedBytes = 0;
+   const bool grown = m_Capacity > m_BufferCapacity;
+
+   for (unsigned int c = 0; c < PARTICLE_COLUMNS; c++) {
+      if (!grown && !(m_DirtyColumns & (1u << c))) {
+	 continue;
+      }
+
+      /* copy target, no vertex array state is touched */
+      GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffers[c]));
+      if (grown) {
+	 GLCall(glBufferData(GL_COPY_WRITE_BUFFER, m_Capacity * sizeof(float), m_Columns[c], GL_DYNAMIC_DRAW));	// https://docs.gl/gl4/glBufferData
+	 m_UploadedBytes += m_Capacity * sizeof(float);
+      } else if (m_Count > 0) {
+	 GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, m_Count * sizeof(float), m_Columns[c]));	// https://docs.gl/gl4/glBufferSubData
+	 m_UploadedBytes += m_Count * sizeof(float);
+      }
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+   if (grown) {
+      m_BufferCapacity = m_Capacity;
+   }
+   m_DirtyColumns = 0;
+}
+
+void ParticleStore::bindColumn(ParticleColumn column, unsigned int location) const {
+   const VertexAttribute attribute = column == PARTICLE_COLOR_INDEX
+      ? vertexAttribute<uint32_t, ATTRIBUTE_INTEGER>(location, "particle_color_index", 0)
+      : vertexAttribute<float, ATTRIBUTE_FLOAT>(location, "particle_column", 0);
+
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[column]));
+   applyVertexAttributes(&attribute, 1, sizeof(float), 0);
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Renderer.h"
+#include "JobSystem.h"
+
+#include <stdint.h> // uint32_t
+
+/* one column per field, every element is 4 bytes */
+enum ParticleColumn : unsigned int {
+   PARTICLE_X = 0,
+   PARTICLE_Y,
+   PARTICLE_Z,
+   PARTICLE_VX,
+   PARTICLE_VY,
+   PARTICLE_VZ,
+   PARTICLE_SCALAR,
+   PARTICLE_COLOR_INDEX,	// uint32_t, an integer attribute in the shader
+   PARTICLE_COLUMNS,
+};
+
+/* Particles stored as structure of arrays: one 64-byte aligned array per field, capacity grown
+ * in whole blocks so every block of every column starts on its own cache line. Update kernels
+ * run block by block over full SSE registers without tails, and jobs working on neighbouring
+ * blocks never share a line. Each column has its own GL buffer that gets the CPU array as
+ * is, there is no interleaving pass: bindColumn() points an attribute straight at it.
+ * Removal swaps the last particle in, so columns stay dense and indices are not stable. */
+class ParticleStore {
+public:
+   static const size_t BLOCK_PARTICLES = 1024;	// capacity granularity, 4 KB per column
+
+private:
+   unsigned char* m_Columns[PARTICLE_COLUMNS];
+   size_t m_Count;
+   size_t m_Capacity;	// in particles, a multiple of BLOCK_PARTICLES
+
+   unsigned int m_Buffers[PARTICLE_COLUMNS];
+   size_t m_BufferCapacity;	// in particles, the same for every column buffer
+   uint32_t m_DirtyColumns;	// bit per column changed since the last upload()
+   size_t m_UploadedBytes;	// by the last upload()
+
+   void grow(size_t capacity);
+
+public:
+   ParticleStore();
+   /* the column buffers go with the context that is current */
+   ~ParticleStore();
+
+   ParticleStore(const ParticleStore&) = delete;
+   ParticleStore& operator=(const ParticleStore&) = delete;
+
+   /* appends count zeroed particles and returns the index of the first one */
+   size_t add(size_t count);
+   /* moves the last particle into i */
+   void remove(size_t i);
+   void clear();
+   void reserve(size_t capacity);
+
+   float* column(ParticleColumn column) { m_DirtyColumns |= 1u << column; return (float*)m_Columns[column]; }
+   const float* column(ParticleColumn column) const { return (const float*)m_Columns[column]; }
+   uint32_t* colorIndices() { m_DirtyColumns |= 1u << PARTICLE_COLOR_INDEX; return (uint32_t*)m_Columns[PARTICLE_COLOR_INDEX]; }
+   const uint32_t* colorIndices() const { return (const uint32_t*)m_Columns[PARTICLE_COLOR_INDEX]; }
+
+   /* non-const column access already counts as a change, this is for writes through kept pointers */
+   void markDirty(ParticleColumn column) { m_DirtyColumns |= 1u << column; }
+
+   /* position += velocity * dt, in parallel over blocks */
+   void integrate(JobSystem& jobs, float dt);
+
+   /* copies every dirty column into its buffer, growing the buffers along with the store */
+   void upload();
+
+   /* points attribute location at one column's buffer, for a vertex array setup. Floats
+    * come in as float, color indices as uint. The buffer name survives upload() growing it */
+   void bindColumn(ParticleColumn column, unsigned int location) const;
+   unsigned int buffer(ParticleColumn column) const { return m_Buffers[column]; }
+
+   size_t size() const { return m_Count; }
+   size_t capacity() const { return m_Capacity; }
+   size_t blockCount() const { return (m_Count + BLOCK_PARTICLES - 1) / BLOCK_PARTICLES; }
+   size_t uploadedBytes() const { return m_UploadedBytes; }
+};
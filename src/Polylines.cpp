@@ -0,0 +1,132 @@
+#include "Polylines.h"
+
+Polylines::Polylines(const std::string& shaderFilePath)
+   : m_VertexArray([this] {
+	/* the four attributes read the same buffer one point apart and move on one point per
+	 * instance, so instance i sees points i to i + 3 */
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_PointBuffer));
+	applyVertexAttributes(VertexFormat<PolylineWindow>::attributes, 4, sizeof(PolylinePoint), 0);
+	for (const VertexAttribute& attribute : VertexFormat<PolylineWindow>::attributes) {
+	   GLCall(glVertexAttribDivisor(attribute.location, 1));	// https://docs.gl/gl4/glVertexAttribDivisor
+	}
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+     }),
+     m_BufferCapacity(0), m_Uploaded(0), m_Polylines(0), m_ScalarMin(0.0f), m_ScalarMax(1.0f) {
+   static_assert(validVertexFormat<PolylineWindow>(), "broken VertexFormat: overlapping, misaligned or out of bounds attributes");
+
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+   m_Shader = createShader(source.VertexSource, source.FragmentSource);
+   checkVertexInputs<PolylineWindow>(m_Shader, "PolylineWindow");
+   GLCall(m_CenterLocation = glGetUniformLocation(m_Shader, "u_Center"));
+   GLCall(m_ScaleLocation = glGetUniformLocation(m_Shader, "u_Scale"));
+   GLCall(m_HalfViewportLocation = glGetUniformLocation(m_Shader, "u_HalfViewport"));
+   GLCall(m_HalfWidthLocation = glGetUniformLocation(m_Shader, "u_HalfWidth"));
+   GLCall(m_ScalarRangeLocation = glGetUniformLocation(m_Shader, "u_ScalarRange"));
+   GLCall(m_LowColorLocation = glGetUniformLocation(m_Shader, "u_LowColor"));
+   GLCall(m_HighColorLocation = glGetUniformLocation(m_Shader, "u_HighColor"));
+
+   GLCall(glGenBuffers(1, &m_PointBuffer));
+
+   const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+   setColors(white, white);
+}
+
+Polylines::~Polylines() {
+   glDeleteBuffers(1, &m_PointBuffer);
+   glDeleteProgram(m_Shader);
+}
+
+void Polylines::reserve(size_t points, size_t polylines) {
+   m_Points.reserve(points + polylines + 1);
+}
+
+void Polylines::addPolyline(const float* xy, const float* scalars, size_t count, size_t stride) {
+   if (count < 2) {
+      return;
+   }
+   if (m_Points.empty()) {
+      m_Points.push_back(POLYLINE_BREAK);
+   }
+   for (size_t i = 0; i < count; i++) {
+      m_Points.push_back({ xy[i * stride], xy[i * stride + 1], scalars ? scalars[i] : 0.0f });
+   }
+   m_Points.push_back(POLYLINE_BREAK);
+   m_Polylines++;
+}
+
+void Polylines::clear() {
+   m_Points.clear();
+   m_Uploaded = 0;
+   m_Polylines = 0;
+}
+
+void Polylines::setScalarRange(float min, float max) {
+   m_ScalarMin = min;
+   m_ScalarMax = max;
+}
+
+void Polylines::setColors(const float low[4], const float high[4]) {
+   for (int c = 0; c < 4; c++) {
+      m_LowColor[c] = low[c];
+      m_HighColor[c] = high[c];
+   }
+}
+
+size_t Polylines::segmentCount() const {
+   /* every polyline brings one point more than it has segments, plus its closing break */
+   return m_Points.empty() ? 0 : m_Points.size() - 1 - 2 * m_Polylines;
+}
+
+/* polylines only ever get appended, so whatever is already up there stays valid and just
+ * the new tail is sent. Outgrowing the buffer sends everything, with room to spare */
+void Polylines::upload() {
+   const size_t points = m_Points.size();
+   if (m_Uploaded == points) {
+      return;
+   }
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_PointBuffer));
+   if (points > m_BufferCapacity) {
+      m_BufferCapacity = points + points / 2;
+      GLCall(glBufferData(GL_COPY_WRITE_BUFFER, m_BufferCapacity * sizeof(PolylinePoint), nullptr, GL_STATIC_DRAW));	// https://docs.gl/gl4/glBufferData
+      m_Uploaded = 0;
+   }
+   GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, m_Uploaded * sizeof(PolylinePoint), (points - m_Uploaded) * sizeof(PolylinePoint),
+			  m_Points.data() + m_Uploaded));	// https://docs.gl/gl4/glBufferSubData
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+   m_Uploaded = points;
+}
+
+void Polylines::draw(const View2D& view, int viewport_height) {
+   const size_t points = m_Points.size();
+   if (points < 4) {
+      return;
+   }
+   ASSERT(m_Uploaded == points); // upload() on the primary first
+
+   const float half_height = viewport_height * 0.5f;
+   const float range = m_ScalarMax - m_ScalarMin;
+   GLCall(glUseProgram(m_Shader));
+   GLCall(glUniform2f(m_CenterLocation, view.center_x, view.center_y));
+   GLCall(glUniform2f(m_ScaleLocation, view.zoom / view.aspect, view.zoom));
+   GLCall(glUniform2f(m_HalfViewportLocation, half_height * view.aspect, half_height));
+   GLCall(glUniform1f(m_HalfWidthLocation, width * 0.5f));
+   GLCall(glUniform2f(m_ScalarRangeLocation, m_ScalarMin, range != 0.0f ? 1.0f / range : 0.0f));
+   GLCall(glUniform4fv(m_LowColorLocation, 1, m_LowColor));	// https://docs.gl/gl4/glUniform
+   GLCall(glUniform4fv(m_HighColorLocation, 1, m_HighColor));
+
+   /* the antialiased edge is alpha coverage */
+   GLboolean blending;
+   GLCall(glGetBooleanv(GL_BLEND, &blending));
+   GLCall(glEnable(GL_BLEND));		// https://docs.gl/gl4/glEnable
+   GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));	// https://docs.gl/gl4/glBlendFunc
+
+   /* the last full window starts 3 points before the end */
+   m_VertexArray.bind();
+   GLCall(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(points - 3)));	// https://docs.gl/gl4/glDrawArraysInstanced
+   GLCall(glBindVertexArray(0));
+
+   if (!blending) {
+      GLCall(glDisable(GL_BLEND));
+   }
+}
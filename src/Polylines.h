@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Views.h"
+#include "VertexLayout.h"
+
+#include <math.h> // NAN
+#include <vector>
+
+struct PolylinePoint {
+   float x;
+   float y;
+   float scalar;	// colors the line over the scalar range, time or speed along a trajectory
+};
+
+/* Polylines are stored back to back, each one after a break point (x is NaN) and the whole
+ * buffer closed by one more: [break, a0, a1, a2, break, b0, b1, break] */
+static const PolylinePoint POLYLINE_BREAK = { NAN, NAN, 0.0f };
+
+/* What one instance sees: the segment start -> end and its neighbours, for the joins.
+ * Four points in a row of the point buffer, instance i starts at point i */
+struct PolylineWindow {
+   float previous[3];
+   float start[3];
+   float end[3];
+   float next[3];
+};
+static_assert(sizeof(PolylineWindow) == 4 * sizeof(PolylinePoint), "PolylineWindow is four consecutive points");
+
+template<> struct VertexFormat<PolylineWindow> {
+   static constexpr VertexAttribute attributes[] = {
+      VERTEX_ATTRIBUTE(PolylineWindow, previous, 0, "polyline_previous", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(PolylineWindow, start, 1, "polyline_start", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(PolylineWindow, end, 2, "polyline_end", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE(PolylineWindow, next, 3, "polyline_next", ATTRIBUTE_FLOAT),
+   };
+};
+
+/* Thick lines for trajectories and streamlines, any number of them in one instanced draw.
+ * Every segment is an instance of a 4-vertex strip: the vertex shader reads the segment's end
+ * points and both neighbours straight from the point buffer (four attributes over the same
+ * buffer, one point apart, advancing once per instance) and grows a quad of the given width in
+ * pixels around it, mitered against its neighbours so consecutive segments meet without gaps or
+ * overlaps. The cpu only ever touches each point once, nothing is triangulated up front, and the
+ * gpu holds 12 bytes per point however wide the lines. Instances that straddle a break collapse
+ * to nothing, two per polyline. Coordinates are data space, drawn through a View2D. */
+class Polylines {
+private:
+   ContextVertexArray m_VertexArray;
+   unsigned int m_PointBuffer;
+   size_t m_BufferCapacity;	// in points
+   unsigned int m_Shader;
+   int m_CenterLocation;
+   int m_ScaleLocation;
+   int m_HalfViewportLocation;
+   int m_HalfWidthLocation;
+   int m_ScalarRangeLocation;
+   int m_LowColorLocation;
+   int m_HighColorLocation;
+
+   std::vector<PolylinePoint> m_Points;	// break first, then every polyline followed by a break
+   size_t m_Uploaded;	// points in the buffer, 0 when the staging copy changed since
+   size_t m_Polylines;
+
+   float m_ScalarMin;
+   float m_ScalarMax;
+   float m_LowColor[4];
+   float m_HighColor[4];
+
+public:
+   float width = 2.0f;	// in pixels
+
+   explicit Polylines(const std::string& shaderFilePath = "../res/shaders/polylines.shader");
+   ~Polylines();
+
+   Polylines(const Polylines&) = delete;
+   Polylines& operator=(const Polylines&) = delete;
+
+   /* reserves room for this many points over all polylines, breaks not included */
+   void reserve(size_t points, size_t polylines);
+   /* xy pairs stride floats apart, scalars may be nullptr for 0. Fewer than 2 points draw nothing */
+   void addPolyline(const float* xy, const float* scalars, size_t count, size_t stride = 2);
+   void clear();
+
+   /* colors are rgba, low at the range's min, high at its max. Same two colors for plain lines */
+   void setScalarRange(float min, float max);
+   void setColors(const float low[4], const float high[4]);
+
+   /* sends whatever was added since the last upload. Once per frame on the primary's context,
+    * before ViewSet::drawAll: that flushes the primary before the other contexts read it */
+   void upload();
+   /* draws every uploaded segment in one call. Can be called once per viewport */
+   void draw(const View2D& view, int viewport_height);
+
+   size_t segmentCount() const;
+   size_t polylineCount() const { return m_Polylines; }
+};
@@ -0,0 +1,101 @@
+#include "ProceduralShapes.h"
+
+#include <string.h> // memset
+
+/* binding point of the Primitives block */
+static const unsigned int PRIMITIVES_BINDING = 0;
+
+/* the block is storage only, the contents come through the DirtyBuffer */
+ProceduralShapes::ProceduralShapes(GpuResources& resources, const std::string& shaderFilePath)
+   : m_Count(0),
+     m_UniformBuffer(resources.createBuffer(GL_UNIFORM_BUFFER, sizeof(m_Primitives), nullptr, GL_DYNAMIC_DRAW)),
+     m_Upload(m_UniformBuffer.get(), m_Primitives, sizeof(m_Primitives), sizeof(ProceduralPrimitive)),	// neighbouring fields merge
+     m_VertexArray([] {}) {
+   GLCall(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+   memset(m_Primitives, 0, sizeof(m_Primitives));
+
+   m_Shader = resources.createProgram(ParseShader(shaderFilePath));
+   const unsigned int shader = m_Shader.get();
+
+   GLCall(unsigned int block = glGetUniformBlockIndex(shader, "Primitives"));	// https://docs.gl/gl4/glGetUniformBlockIndex
+   ASSERT(block != GL_INVALID_INDEX);
+   GLCall(glUniformBlockBinding(shader, block, PRIMITIVES_BINDING));	// https://docs.gl/gl4/glUniformBlockBinding
+
+   GLCall(m_PrimitiveLocation = glGetUniformLocation(shader, "u_Primitive"));
+   GLCall(m_CenterLocation = glGetUniformLocation(shader, "u_Center"));
+   GLCall(m_ScaleLocation = glGetUniformLocation(shader, "u_Scale"));
+}
+
+unsigned int ProceduralShapes::add(ProceduralKind kind, float x0, float y0, float x1, float y1, const float color[4]) {
+   ASSERT(m_Count < MAX_PRIMITIVES);
+   const unsigned int primitive = m_Count++;
+   ProceduralPrimitive& p = m_Primitives[primitive];
+   p.info[0] = kind;
+   p.info[1] = 1;
+   p.info[2] = 1;
+   setCorners(primitive, x0, y0, x1, y1);
+   setColor(primitive, color[0], color[1], color[2], color[3]);
+   m_Upload.markDirty(primitive * sizeof(ProceduralPrimitive), sizeof(ProceduralPrimitive));
+   return primitive;
+}
+
+unsigned int ProceduralShapes::addQuad(float x0, float y0, float x1, float y1, const float color[4]) {
+   return add(PROCEDURAL_QUAD, x0, y0, x1, y1, color);
+}
+
+unsigned int ProceduralShapes::addLine(float x0, float y0, float x1, float y1, float thickness, const float color[4]) {
+   const unsigned int primitive = add(PROCEDURAL_LINE, x0, y0, x1, y1, color);
+   m_Primitives[primitive].width[0] = thickness;
+   return primitive;
+}
+
+unsigned int ProceduralShapes::addGrid(float x0, float y0, float x1, float y1, int columns, int rows, float gap, const float color[4]) {
+   const unsigned int primitive = add(PROCEDURAL_GRID, x0, y0, x1, y1, color);
+   m_Primitives[primitive].width[0] = gap;
+   m_Primitives[primitive].info[1] = columns > 0 ? columns : 1;
+   m_Primitives[primitive].info[2] = rows > 0 ? rows : 1;
+   return primitive;
+}
+
+void ProceduralShapes::setCorners(unsigned int primitive, float x0, float y0, float x1, float y1) {
+   float* corners = m_Primitives[primitive].corners;
+   corners[0] = x0;
+   corners[1] = y0;
+   corners[2] = x1;
+   corners[3] = y1;
+   m_Upload.markDirty((const unsigned char*)corners - (const unsigned char*)m_Primitives, sizeof(m_Primitives[primitive].corners));
+}
+
+void ProceduralShapes::setColor(unsigned int primitive, float r, float g, float b, float a) {
+   float* color = m_Primitives[primitive].color;
+   color[0] = r;
+   color[1] = g;
+   color[2] = b;
+   color[3] = a;
+   m_Upload.markDirty((const unsigned char*)color - (const unsigned char*)m_Primitives, sizeof(m_Primitives[primitive].color));
+}
+
+void ProceduralShapes::upload() {
+   m_Upload.flush(); // nothing when nothing changed
+}
+
+void ProceduralShapes::draw(const View2D& view) {
+   if (m_Count == 0) {
+      return;
+   }
+   ASSERT(!m_Upload.dirty());
+
+   GLCall(glUseProgram(m_Shader.get()));
+   GLCall(glUniform2f(m_CenterLocation, view.center_x, view.center_y));
+   GLCall(glUniform2f(m_ScaleLocation, view.zoom / view.aspect, view.zoom));
+   GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, PRIMITIVES_BINDING, m_UniformBuffer.get()));	// https://docs.gl/gl4/glBindBufferBase
+
+   m_VertexArray.bind();
+   for (unsigned int primitive = 0; primitive < m_Count; primitive++) {
+      const ProceduralPrimitive& p = m_Primitives[primitive];
+      GLCall(glUniform1i(m_PrimitiveLocation, primitive));
+      /* two triangles per quad, grids one instance per cell */
+      GLCall(glDrawArraysInstanced(GL_TRIANGLES, 0, 6, p.info[0] == PROCEDURAL_GRID ? p.info[1] * p.info[2] : 1));	// https://docs.gl/gl4/glDrawArraysInstanced
+   }
+   GLCall(glBindVertexArray(0));
+}
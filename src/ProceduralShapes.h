@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Views.h"
+#include "DirtyBuffer.h"
+#include "GpuResources.h"
+
+#include <stdint.h> // int32_t
+
+enum ProceduralKind : int32_t {
+   PROCEDURAL_QUAD = 0,
+   PROCEDURAL_LINE,
+   PROCEDURAL_GRID,
+};
+
+/* std140 layout of one entry in the Primitives uniform block, 64 bytes */
+struct ProceduralPrimitive {
+   float corners[4];	// x0, y0, x1, y1: quad and grid corners, line end points
+   float color[4];
+   float width[4];	// x: line thickness, gap between grid cells
+   int32_t info[4];	// kind, columns, rows, unused
+};
+static_assert(sizeof(ProceduralPrimitive) == 64, "ProceduralPrimitive has to match the std140 block");
+
+/* Quads, thick lines and grids with no vertex data at all: the vertex shader builds every
+ * corner from gl_VertexID, and grid cells from gl_InstanceID, out of a few parameters per
+ * primitive in a uniform block. Moving or recoloring a primitive changes a handful of bytes,
+ * and only those bytes are uploaded (a DirtyBuffer over the block). One draw per primitive,
+ * a grid of any size included. Coordinates are data space, drawn through a View2D.
+ * The block and the program belong to a GpuResources table, deleted once the gpu is done. */
+class ProceduralShapes {
+public:
+   static const unsigned int MAX_PRIMITIVES = 256;	// 16 KB, the smallest uniform block GL guarantees
+
+private:
+   ProceduralPrimitive m_Primitives[MAX_PRIMITIVES];
+   unsigned int m_Count;
+
+   BufferHandle m_UniformBuffer;
+   DirtyBuffer m_Upload;
+   ContextVertexArray m_VertexArray;	// empty, core profiles still want one bound
+   ProgramHandle m_Shader;
+   int m_PrimitiveLocation;
+   int m_CenterLocation;
+   int m_ScaleLocation;
+
+   unsigned int add(ProceduralKind kind, float x0, float y0, float x1, float y1, const float color[4]);
+
+public:
+   explicit ProceduralShapes(GpuResources& resources, const std::string& shaderFilePath = "../res/shaders/procedural.shader");
+
+   ProceduralShapes(const ProceduralShapes&) = delete;
+   ProceduralShapes& operator=(const ProceduralShapes&) = delete;
+
+   /* each returns the primitive's id, colors are rgba */
+   unsigned int addQuad(float x0, float y0, float x1, float y1, const float color[4]);
+   unsigned int addLine(float x0, float y0, float x1, float y1, float thickness, const float color[4]);
+   /* columns x rows cells over the rectangle, gap apart */
+   unsigned int addGrid(float x0, float y0, float x1, float y1, int columns, int rows, float gap, const float color[4]);
+
+   void setCorners(unsigned int primitive, float x0, float y0, float x1, float y1);
+   void setColor(unsigned int primitive, float r, float g, float b, float a);
+
+   /* sends whatever changed. Once per frame on the primary's context, before ViewSet::drawAll:
+    * that flushes the primary before the other contexts read the block */
+   void upload();
+   /* draws every primitive, upload() has to have run since the last change */
+   void draw(const View2D& view);
+
+   const DirtyBuffer& uploads() const { return m_Upload; }
+};
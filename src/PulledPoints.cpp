@@ -0,0 +1,167 @@
+#include "PulledPoints.h"
+
+#include <iostream> // input/output stream
+
+/* storage block binding or texture unit, depending on the path */
+static const unsigned int POSITION_SLOT = 0;
+static const unsigned int SCALAR_SLOT = 1;
+
+/* the extension alone isn't enough, some drivers only allow storage blocks in fragment and compute shaders */
+static bool storageBuffersInVertexShaders() {
+   if (!GLEW_VERSION_4_3 && !GLEW_ARB_shader_storage_buffer_object) {
+      return false;
+   }
+   int blocks = 0;
+   GLCall(glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &blocks));	// https://docs.gl/gl4/glGet
+   return blocks >= 2;
+}
+
+static void bindStorageBlock(unsigned int shader, const char* name, unsigned int binding) {
+   GLCall(unsigned int block = glGetProgramResourceIndex(shader, GL_SHADER_STORAGE_BLOCK, name));	// https://docs.gl/gl4/glGetProgramResourceIndex
+   if (block != GL_INVALID_INDEX) {
+      GLCall(glShaderStorageBlockBinding(shader, block, binding));	// https://docs.gl/gl4/glShaderStorageBlockBinding
+   }
+}
+
+/* first word, words per element, components (0 for absent), words per component */
+static void setLayout(int location, const PulledArray& array) {
+   const unsigned int component_words = array.type == PULLED_FLOAT64 ? 2 : 1;
+   const size_t stride = array.stride ? array.stride : array.components * component_words * 4;
+   GLCall(glUniform4ui(location, (GLuint)(array.offset / 4), (GLuint)(stride / 4), array.buffer ? array.components : 0, component_words));	// https://docs.gl/gl4/glUniform
+}
+
+PulledPoints::PulledPoints(const std::string& shaderFilePath)
+   : m_StorageBuffers(storageBuffersInVertexShaders()),
+     m_PositionTexture(0), m_ScalarTexture(0), m_MaxBytes(0),
+     m_VertexArray([] {}),
+     m_ScalarMin(0.0f), m_ScalarMax(1.0f) {
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+   if (m_StorageBuffers) {
+      source.VertexSource = injectDefines(source.VertexSource, "#define PULL_SSBO 1\n");
+   }
+   m_Shader = createShader(source.VertexSource, source.FragmentSource);
+
+   GLCall(m_MVPLocation = glGetUniformLocation(m_Shader, "u_MVP"));
+   GLCall(m_PositionLayoutLocation = glGetUniformLocation(m_Shader, "u_PositionLayout"));
+   GLCall(m_ScalarLayoutLocation = glGetUniformLocation(m_Shader, "u_ScalarLayout"));
+   GLCall(m_ScalarRangeLocation = glGetUniformLocation(m_Shader, "u_ScalarRange"));
+   GLCall(m_PointSizeLocation = glGetUniformLocation(m_Shader, "u_PointSize"));
+
+   if (m_StorageBuffers) {
+      bindStorageBlock(m_Shader, "PositionWords", POSITION_SLOT);
+      bindStorageBlock(m_Shader, "ScalarWords", SCALAR_SLOT);
+      GLint64 max_block = 0;
+      GLCall(glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &max_block));
+      m_MaxBytes = (size_t)max_block;
+   } else {
+      GLCall(glGenTextures(1, &m_PositionTexture));
+      GLCall(glGenTextures(1, &m_ScalarTexture));
+      GLCall(glUseProgram(m_Shader));
+      GLCall(glUniform1i(glGetUniformLocation(m_Shader, "u_PositionWords"), POSITION_SLOT));
+      GLCall(glUniform1i(glGetUniformLocation(m_Shader, "u_ScalarWords"), SCALAR_SLOT));
+      GLCall(glUseProgram(0));
+      int max_texels = 0;
+      GLCall(glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels));
+      m_MaxBytes = (size_t)max_texels * 4;
+   }
+   std::cout << "[PulledPoints]: pulling through " << (m_StorageBuffers ? "shader storage buffers" : "texture buffers")
+	     << ", up to " << (m_MaxBytes >> 20) << " MB per buffer" << std::endl;
+}
+
+PulledPoints::~PulledPoints() {
+   if (!m_StorageBuffers) {
+      glDeleteTextures(1, &m_PositionTexture);	// https://docs.gl/gl4/glDeleteTextures
+      glDeleteTextures(1, &m_ScalarTexture);
+   }
+   glDeleteProgram(m_Shader);
+}
+
+bool PulledPoints::accept(const PulledArray& array, unsigned int max_components, const char* name) const {
+   if (array.offset % 4 != 0 || array.stride % 4 != 0) {
+      std::cout << "[PulledPoints]: " << name << " offset and stride have to be multiples of 4 bytes" << std::endl;
+      return false;
+   }
+   if (array.components < 1 || array.components > max_components) {
+      std::cout << "[PulledPoints]: " << name << " can't have " << array.components << " components" << std::endl;
+      return false;
+   }
+
+   GLint64 size = 0;
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, array.buffer));
+   GLCall(glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size));	// https://docs.gl/gl4/glGetBufferParameter
+   GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+   if ((size_t)size > m_MaxBytes) {
+      std::cout << "[PulledPoints]: " << name << " buffer is " << size << " bytes, the shader can only reach "
+		<< m_MaxBytes << std::endl;
+      return false;
+   }
+   return true;
+}
+
+/* the texture is a view of the buffer object, it follows the buffer through glBufferData */
+void PulledPoints::attachTexture(unsigned int texture, unsigned int buffer) {
+   GLCall(glBindTexture(GL_TEXTURE_BUFFER, texture));
+   GLCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, buffer));	// https://docs.gl/gl4/glTexBuffer
+   GLCall(glBindTexture(GL_TEXTURE_BUFFER, 0));
+}
+
+bool PulledPoints::setPositions(const PulledArray& positions) {
+   if (!positions.buffer || !accept(positions, 3, "positions")) {
+      return false;
+   }
+   m_Positions = positions;
+   if (!m_StorageBuffers) {
+      attachTexture(m_PositionTexture, positions.buffer);
+   }
+   return true;
+}
+
+bool PulledPoints::setScalars(const PulledArray& scalars) {
+   if (scalars.buffer && !accept(scalars, 1, "scalars")) {
+      return false;
+   }
+   m_Scalars = scalars;
+   if (!m_StorageBuffers) {
+      attachTexture(m_ScalarTexture, scalars.buffer);
+   }
+   return true;
+}
+
+void PulledPoints::setScalarRange(float min, float max) {
+   m_ScalarMin = min;
+   m_ScalarMax = max;
+}
+
+void PulledPoints::draw(const float* mvp, size_t first, size_t count, float point_size) {
+   if (count == 0 || !m_Positions.buffer) {
+      return;
+   }
+
+   GLCall(glUseProgram(m_Shader));
+   GLCall(glUniformMatrix4fv(m_MVPLocation, 1, GL_FALSE, mvp));	// https://docs.gl/gl4/glUniform
+   GLCall(glUniform1f(m_PointSizeLocation, point_size));
+   GLCall(glEnable(GL_PROGRAM_POINT_SIZE));	// https://docs.gl/gl4/glEnable
+   const float range = m_ScalarMax - m_ScalarMin;
+   GLCall(glUniform2f(m_ScalarRangeLocation, m_ScalarMin, range != 0.0f ? 1.0f / range : 0.0f));
+   setLayout(m_PositionLayoutLocation, m_Positions);
+   setLayout(m_ScalarLayoutLocation, m_Scalars);
+
+   if (m_StorageBuffers) {
+      /* without scalars the block is never read, but it shouldn't be left unbound either */
+      GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POSITION_SLOT, m_Positions.buffer));	// https://docs.gl/gl4/glBindBufferBase
+      GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SCALAR_SLOT, m_Scalars.buffer ? m_Scalars.buffer : m_Positions.buffer));
+   } else {
+      GLCall(glActiveTexture(GL_TEXTURE0 + POSITION_SLOT));	// https://docs.gl/gl4/glActiveTexture
+      GLCall(glBindTexture(GL_TEXTURE_BUFFER, m_PositionTexture));
+      GLCall(glActiveTexture(GL_TEXTURE0 + SCALAR_SLOT));
+      GLCall(glBindTexture(GL_TEXTURE_BUFFER, m_ScalarTexture));
+      GLCall(glActiveTexture(GL_TEXTURE0));
+   }
+
+   /* gl_VertexID runs from first, so it is the element index as is */
+   m_VertexArray.bind();
+   GLCall(glDrawArrays(GL_POINTS, (GLint)first, (GLsizei)count));	// https://docs.gl/gl4/glDrawArrays
+
+   GLCall(glDisable(GL_PROGRAM_POINT_SIZE));
+   GLCall(glBindVertexArray(0));
+}
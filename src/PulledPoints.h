@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Views.h"
+
+enum PulledType : unsigned int {
+   PULLED_FLOAT32 = 0,
+   PULLED_FLOAT64,
+};
+
+/* Where one attribute lives in a buffer the application already has, in its own layout.
+ * offset and stride are in bytes and have to be multiples of 4, stride 0 is tightly packed */
+struct PulledArray {
+   unsigned int buffer = 0;
+   size_t offset = 0;
+   size_t stride = 0;
+   unsigned int components = 1;	// 1 to 3
+   PulledType type = PULLED_FLOAT32;
+};
+
+/* Points drawn straight from the simulation's own buffers with no vertex attributes at all:
+ * the vertex shader fetches 32-bit words by gl_VertexID and puts the attributes together itself.
+ * Interleaved structs with odd strides, positions stored as doubles, scalars in a separate
+ * array, whatever the buffer holds is read as is, no conversion pass and no second copy.
+ * Doubles are narrowed to float in the shader with bit operations, so no fp64 is needed.
+ *
+ * Reads go through shader storage buffers where the driver has them (4.3 or
+ * ARB_shader_storage_buffer_object, with storage blocks allowed in vertex shaders), through
+ * r32ui texture buffers over the same buffers otherwise. Same shader, picked by a define. */
+class PulledPoints {
+private:
+   bool m_StorageBuffers;
+   PulledArray m_Positions;
+   PulledArray m_Scalars;
+   unsigned int m_PositionTexture;	// texture buffer path only, a view of m_Positions.buffer
+   unsigned int m_ScalarTexture;
+   size_t m_MaxBytes;		// largest buffer the shader can address
+   ContextVertexArray m_VertexArray;	// empty, core profiles still want one bound
+   unsigned int m_Shader;
+   int m_MVPLocation;
+   int m_PositionLayoutLocation;
+   int m_ScalarLayoutLocation;
+   int m_ScalarRangeLocation;
+   int m_PointSizeLocation;
+   float m_ScalarMin;
+   float m_ScalarMax;
+
+   bool accept(const PulledArray& array, unsigned int max_components, const char* name) const;
+   void attachTexture(unsigned int texture, unsigned int buffer);
+
+public:
+   explicit PulledPoints(const std::string& shaderFilePath = "../res/shaders/pulled_points.shader");
+   ~PulledPoints();
+
+   PulledPoints(const PulledPoints&) = delete;
+   PulledPoints& operator=(const PulledPoints&) = delete;
+
+   /* false, with a message, when the layout can't be read (misaligned, too big), nothing changes then.
+    * Only describes the buffers, their contents can change at any time without telling */
+   bool setPositions(const PulledArray& positions);
+   /* one component, colors the points over the scalar range. A zero buffer drops the scalars */
+   bool setScalars(const PulledArray& scalars);
+   void setScalarRange(float min, float max);
+
+   /* elements [first, first + count), mvp is a column-major 4x4 matrix, point size in pixels */
+   void draw(const float* mvp, size_t first, size_t count, float point_size);
+
+   bool usesStorageBuffers() const { return m_StorageBuffers; }
+};
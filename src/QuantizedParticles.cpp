@@ -0,0 +1,267 @@
+#include "QuantizedParticles.h"
+
+#include <algorithm> // std::min, std::max
+#include <math.h> // lrintf
+#include <string.h> // memcpy
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+///----------------///
+///- QUANTIZATION -///
+///----------------///
+
+/* the same steps as the SSE2 version below, Fabian Giesen's round-to-nearest-even conversion:
+ * https://gist.github.com/rygorous/2156668 */
+uint16_t floatToHalf(float value) {
+   uint32_t f;
+   memcpy(&f, &value, sizeof(f));
+   const uint32_t sign = f & 0x80000000u;
+   f ^= sign;
+
+   uint32_t half;
+   if (f >= 0x47800000u) { // too large for a half: infinity, or NaN if it was one
+      half = f > 0x7F800000u ? 0x7E00u : 0x7C00u;
+   } else if (f < 0x38800000u) { // subnormal half, a float add does the rounding
+      const uint32_t magic_bits = ((127 - 15) + (23 - 10) + 1) << 23;
+      float magic, sum;
+      memcpy(&magic, &magic_bits, sizeof(magic));
+      memcpy(&sum, &f, sizeof(sum));
+      sum += magic;
+      memcpy(&half, &sum, sizeof(half));
+      half -= magic_bits;
+   } else {
+      const uint32_t mantissa_odd = (f >> 13) & 1;
+      f += ((uint32_t)(15 - 127) << 23) + 0xFFFu + mantissa_odd;
+      half = f >> 13;
+   }
+   return (uint16_t)(half | (sign >> 16));
+}
+
+static inline uint16_t* outputAt(void* out, size_t out_stride, size_t i) {
+   return (uint16_t*)((unsigned char*)out + i * out_stride);
+}
+
+#if defined(__SSE2__)
+/* four strided floats, one load when they are contiguous */
+static inline __m128 load4(const float* values, size_t stride) {
+   if (stride == 1) {
+      return _mm_loadu_ps(values);
+   }
+   return _mm_setr_ps(values[0], values[stride], values[2 * stride], values[3 * stride]);
+}
+
+/* the low 16 bits of each lane to four strided outputs */
+static inline void store4x16(__m128i lanes, uint16_t* out, size_t out_stride) {
+   *outputAt(out, out_stride, 0) = (uint16_t)_mm_extract_epi16(lanes, 0);
+   *outputAt(out, out_stride, 1) = (uint16_t)_mm_extract_epi16(lanes, 2);
+   *outputAt(out, out_stride, 2) = (uint16_t)_mm_extract_epi16(lanes, 4);
+   *outputAt(out, out_stride, 3) = (uint16_t)_mm_extract_epi16(lanes, 6);
+}
+
+static inline __m128i floatToHalf4(__m128 f) {
+   const __m128i sign_mask = _mm_set1_epi32((int)0x80000000u);
+   const __m128i half_max = _mm_set1_epi32((127 + 16) << 23);		// anything from here rounds to infinity
+   const __m128i float_infinity = _mm_set1_epi32(0x7F800000);
+   const __m128i half_infinity = _mm_set1_epi32(0x7C00);
+   const __m128i nan_bit = _mm_set1_epi32(0x200);
+   const __m128i min_normal = _mm_set1_epi32((127 - 14) << 23);		// smallest float that gives a normal half
+   const __m128i subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+   const __m128i normal_bias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+   const __m128i bits = _mm_castps_si128(f);
+   const __m128i sign = _mm_and_si128(bits, sign_mask);
+   const __m128i magnitude = _mm_xor_si128(bits, sign);
+
+   const __m128i is_nan = _mm_cmpgt_epi32(magnitude, float_infinity);
+   const __m128i is_regular = _mm_cmpgt_epi32(half_max, magnitude);
+   const __m128i is_subnormal = _mm_cmpgt_epi32(min_normal, magnitude);
+   const __m128i special = _mm_or_si128(_mm_and_si128(is_nan, nan_bit), half_infinity);
+
+   const __m128 subnormal_sum = _mm_add_ps(_mm_castsi128_ps(magnitude), _mm_castsi128_ps(subnormal_magic));
+   const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormal_sum), subnormal_magic);
+
+   const __m128i mantissa_odd = _mm_srai_epi32(_mm_slli_epi32(magnitude, 31 - 13), 31); // -1 when odd
+   const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(magnitude, normal_bias), mantissa_odd), 13);
+
+   const __m128i finite = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+   const __m128i result = _mm_or_si128(_mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, special));
+   return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+}
+#endif
+
+void quantizeUnorm16(const float* values, size_t value_stride, size_t count, float min, float extent,
+		     uint16_t* out, size_t out_stride) {
+   const float scale = extent > 0.0f ? 65535.0f / extent : 0.0f;
+   size_t i = 0;
+
+#if defined(__SSE2__)
+   const __m128 min4 = _mm_set1_ps(min);
+   const __m128 scale4 = _mm_set1_ps(scale);
+   const __m128i bias = _mm_set1_epi32(32768);
+   const __m128i flip = _mm_set1_epi16((short)0x8000);
+   for (; i + 4 <= count; i += 4) {
+      const __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(load4(values + i * value_stride, value_stride), min4), scale4));
+      /* SSE2 only saturates to signed 16 bits: shift down by 32768, saturate, shift back up */
+      const __m128i shifted = _mm_packs_epi32(_mm_sub_epi32(rounded, bias), _mm_sub_epi32(rounded, bias));
+      const __m128i clamped = _mm_xor_si128(shifted, flip);
+      *outputAt(out, out_stride, i + 0) = (uint16_t)_mm_extract_epi16(clamped, 0);
+      *outputAt(out, out_stride, i + 1) = (uint16_t)_mm_extract_epi16(clamped, 1);
+      *outputAt(out, out_stride, i + 2) = (uint16_t)_mm_extract_epi16(clamped, 2);
+      *outputAt(out, out_stride, i + 3) = (uint16_t)_mm_extract_epi16(clamped, 3);
+   }
+#endif
+
+   for (; i < count; i++) {
+      const long rounded = lrintf((values[i * value_stride] - min) * scale);
+      *outputAt(out, out_stride, i) = (uint16_t)std::min(65535L, std::max(0L, rounded));
+   }
+}
+
+void quantizeHalf(const float* values, size_t value_stride, size_t count, uint16_t* out, size_t out_stride) {
+   size_t i = 0;
+
+#if defined(__SSE2__)
+   for (; i + 4 <= count; i += 4) {
+      store4x16(floatToHalf4(load4(values + i * value_stride, value_stride)), outputAt(out, out_stride, i), out_stride);
+   }
+#endif
+
+   for (; i < count; i++) {
+      *outputAt(out, out_stride, i) = floatToHalf(values[i * value_stride]);
+   }
+}
+
+void quantizeColors(const float* rgba, size_t rgba_stride, size_t count, uint8_t* out, size_t out_stride) {
+   size_t i = 0;
+
+#if defined(__SSE2__)
+   /* one color per register, four at a time so the packs fill a whole register */
+   const __m128 scale = _mm_set1_ps(255.0f);
+   for (; i + 4 <= count; i += 4) {
+      const __m128i c0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(rgba + (i + 0) * rgba_stride), scale));
+      const __m128i c1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(rgba + (i + 1) * rgba_stride), scale));
+      const __m128i c2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(rgba + (i + 2) * rgba_stride), scale));
+      const __m128i c3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(rgba + (i + 3) * rgba_stride), scale));
+      const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3)); // saturates to [0, 255]
+
+      uint32_t colors[4];
+      _mm_storeu_si128((__m128i*)colors, bytes);
+      for (int k = 0; k < 4; k++) {
+	 memcpy(out + (i + k) * out_stride, &colors[k], 4);
+      }
+   }
+#endif
+
+   for (; i < count; i++) {
+      for (int c = 0; c < 4; c++) {
+	 const long rounded = lrintf(rgba[i * rgba_stride + c] * 255.0f);
+	 out[i * out_stride + c] = (uint8_t)std::min(255L, std::max(0L, rounded));
+      }
+   }
+}
+
+///-----------------------///
+///- QUANTIZED PARTICLES -///
+///-----------------------///
+
+QuantizedParticles::QuantizedParticles(JobSystem& jobs, size_t chunk_size, const std::string& shaderFilePath)
+   : m_Jobs(jobs),
+     m_VertexArray([this] {
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer));
+	applyVertexLayout<QuantizedVertex>();
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+     }),
+     m_BufferCapacity(0), m_ChunkSize(std::max<size_t>(1, chunk_size)), m_Count(0) {
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+   m_Shader = createShader(source.VertexSource, source.FragmentSource);
+   checkVertexInputs<QuantizedVertex>(m_Shader, "QuantizedVertex");
+
+   GLCall(m_MVPLocation = glGetUniformLocation(m_Shader, "u_MVP"));
+   GLCall(m_ChunkMinLocation = glGetUniformLocation(m_Shader, "u_ChunkMin"));
+   GLCall(m_ChunkExtentLocation = glGetUniformLocation(m_Shader, "u_ChunkExtent"));
+   GLCall(m_PointSizeLocation = glGetUniformLocation(m_Shader, "u_PointSize"));
+
+   GLCall(glGenBuffers(1, &m_VertexBuffer));
+}
+
+QuantizedParticles::~QuantizedParticles() {
+   glDeleteBuffers(1, &m_VertexBuffer);
+   glDeleteProgram(m_Shader);
+}
+
+void QuantizedParticles::upload(const float* positions, size_t position_stride, const float* scalars, size_t scalar_stride,
+				const float* colors, size_t color_stride, size_t count) {
+   m_Count = count;
+   m_Staging.resize(count);
+   m_Chunks.resize((count + m_ChunkSize - 1) / m_ChunkSize);
+
+   m_Jobs.parallelFor(m_Chunks.size(), [&](size_t c) {
+      Chunk& chunk = m_Chunks[c];
+      const size_t first = c * m_ChunkSize;
+      const size_t n = std::min(m_ChunkSize, count - first);
+      chunk.first = (GLint)first;
+      chunk.count = (GLsizei)n;
+
+      QuantizedVertex* out = &m_Staging[first];
+      const float* chunk_positions = positions + first * position_stride;
+      for (int axis = 0; axis < 3; axis++) {
+	 float low = chunk_positions[axis], high = chunk_positions[axis];
+	 for (size_t i = 1; i < n; i++) {
+	    low = std::min(low, chunk_positions[i * position_stride + axis]);
+	    high = std::max(high, chunk_positions[i * position_stride + axis]);
+	 }
+	 chunk.min[axis] = low;
+	 chunk.extent[axis] = high - low;
+	 quantizeUnorm16(chunk_positions + axis, position_stride, n, low, high - low, &out->position[axis], sizeof(QuantizedVertex));
+      }
+
+      if (scalars) {
+	 quantizeHalf(scalars + first * scalar_stride, scalar_stride, n, &out->scalar, sizeof(QuantizedVertex));
+      } else {
+	 for (size_t i = 0; i < n; i++) {
+	    out[i].scalar = 0x3C00; // 1.0
+	 }
+      }
+
+      if (colors) {
+	 quantizeColors(colors + first * color_stride, color_stride, n, out->color, sizeof(QuantizedVertex));
+      } else {
+	 for (size_t i = 0; i < n; i++) {
+	    memset(out[i].color, 0xFF, sizeof(out[i].color));
+	 }
+      }
+   }, 1);
+
+   /* copy target, no vertex array state is touched */
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_VertexBuffer));
+   if (count > m_BufferCapacity) {
+      GLCall(glBufferData(GL_COPY_WRITE_BUFFER, count * sizeof(QuantizedVertex), m_Staging.data(), GL_DYNAMIC_DRAW));	// https://docs.gl/gl4/glBufferData
+      m_BufferCapacity = count;
+   } else {
+      GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, count * sizeof(QuantizedVertex), m_Staging.data()));	// https://docs.gl/gl4/glBufferSubData
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void QuantizedParticles::draw(const float* mvp) {
+   if (m_Count == 0) {
+      return;
+   }
+
+   GLCall(glUseProgram(m_Shader));
+   GLCall(glUniformMatrix4fv(m_MVPLocation, 1, GL_FALSE, mvp));	// https://docs.gl/gl4/glUniform
+   GLCall(glUniform1f(m_PointSizeLocation, point_size));
+   GLCall(glEnable(GL_PROGRAM_POINT_SIZE));	// https://docs.gl/gl4/glEnable
+
+   m_VertexArray.bind();
+   for (const Chunk& chunk : m_Chunks) {
+      GLCall(glUniform3fv(m_ChunkMinLocation, 1, chunk.min));
+      GLCall(glUniform3fv(m_ChunkExtentLocation, 1, chunk.extent));
+      GLCall(glDrawArrays(GL_POINTS, chunk.first, chunk.count));	// https://docs.gl/gl4/glDrawArrays
+   }
+
+   GLCall(glDisable(GL_PROGRAM_POINT_SIZE));
+   GLCall(glBindVertexArray(0));
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Renderer.h"
+#include "JobSystem.h"
+#include "Views.h"
+#include "VertexLayout.h"
+
+#include <stdint.h> // uint16_t, uint8_t
+#include <vector>
+
+/* 12 bytes per particle where plain floats take 32 */
+struct QuantizedVertex {
+   uint16_t position[3];	// unorm16 inside the chunk's bounding box
+   uint16_t scalar;		// half float
+   uint8_t color[4];		// unorm8 rgba
+};
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex has to stay tightly packed");
+
+template<> struct VertexFormat<QuantizedVertex> {
+   static constexpr VertexAttribute attributes[] = {
+      VERTEX_ATTRIBUTE(QuantizedVertex, position, 0, "quantized_position", ATTRIBUTE_NORMALIZED),
+      VERTEX_ATTRIBUTE(QuantizedVertex, scalar, 1, "particle_scalar", ATTRIBUTE_HALF),
+      VERTEX_ATTRIBUTE(QuantizedVertex, color, 2, "particle_color", ATTRIBUTE_NORMALIZED),
+   };
+};
+
+/* The quantization passes, SSE2 four values at a time where available, scalar otherwise.
+ * Both round to nearest even and clamp, so they give the same bits.
+ * Input strides are in floats, output strides in bytes. */
+
+/* round((value - min) / extent * 65535) */
+void quantizeUnorm16(const float* values, size_t value_stride, size_t count, float min, float extent,
+		     uint16_t* out, size_t out_stride);
+/* IEEE half, overflow goes to infinity, NaN stays NaN */
+void quantizeHalf(const float* values, size_t value_stride, size_t count, uint16_t* out, size_t out_stride);
+/* rgba in [0, 1] to round(c * 255) */
+void quantizeColors(const float* rgba, size_t rgba_stride, size_t count, uint8_t* out, size_t out_stride);
+
+uint16_t floatToHalf(float value);
+
+/* Particle cloud uploaded as QuantizedVertex. Particles are split into fixed-size chunks and
+ * positions are stored relative to each chunk's own bounding box, so 16 bits go a long way
+ * when the chunks are spatially coherent (simulation output usually is). The vertex shader
+ * maps them back from per-chunk uniforms. Chunks are quantized in parallel on the job system. */
+class QuantizedParticles {
+private:
+   struct Chunk {
+      GLint first;
+      GLsizei count;
+      float min[3];
+      float extent[3];
+   };
+
+   JobSystem& m_Jobs;
+   ContextVertexArray m_VertexArray;
+   unsigned int m_VertexBuffer;
+   size_t m_BufferCapacity;	// in particles
+   unsigned int m_Shader;
+   int m_MVPLocation;
+   int m_ChunkMinLocation;
+   int m_ChunkExtentLocation;
+   int m_PointSizeLocation;
+
+   size_t m_ChunkSize;
+   std::vector<Chunk> m_Chunks;
+   std::vector<QuantizedVertex> m_Staging;
+   size_t m_Count;
+
+public:
+   float point_size = 2.0f;	// in pixels, scaled by each particle's scalar
+
+   explicit QuantizedParticles(JobSystem& jobs, size_t chunk_size = 16384,
+			       const std::string& shaderFilePath = "../res/shaders/quantized_particles.shader");
+   ~QuantizedParticles();
+
+   QuantizedParticles(const QuantizedParticles&) = delete;
+   QuantizedParticles& operator=(const QuantizedParticles&) = delete;
+
+   /* positions are xyz, colors rgba, strides in floats between consecutive particles.
+    * scalars or colors may be nullptr, for 1.0 and opaque white */
+   void upload(const float* positions, size_t position_stride, const float* scalars, size_t scalar_stride,
+	       const float* colors, size_t color_stride, size_t count);
+
+   /* mvp is a column-major 4x4 matrix */
+   void draw(const float* mvp);
+
+   size_t count() const { return m_Count; }
+   size_t uploadBytes() const { return m_Count * sizeof(QuantizedVertex); }
+   size_t floatBytes() const { return m_Count * 8 * sizeof(float); }	// xyz, scalar and rgba as floats
+};
@@ -0,0 +1,280 @@
+#include "Recording.h"
+
+#include <iostream> // input/output stream
+#include <string.h> // memcpy, memcmp
+
+static const size_t NO_STEP = (size_t)-1;
+
+/* a run header costs as much as two floats, so unchanged gaps this short are cheaper to store */
+static const size_t RUN_MERGE_GAP = 2;
+
+///-----------///
+///- WRITING -///
+///-----------///
+
+RecordingWriter::RecordingWriter()
+   : m_Offset(0), m_KeyframeInterval(1), m_SinceKeyframe(0) {
+}
+
+RecordingWriter::~RecordingWriter() {
+   close();
+}
+
+void RecordingWriter::write(const void* data, size_t size) {
+   m_Stream.write((const char*)data, size);
+   m_Offset += size;
+}
+
+bool RecordingWriter::open(const std::string& filePath, size_t frame_floats, uint32_t keyframe_interval) {
+   close();
+
+   m_Stream.open(filePath, std::ios::binary | std::ios::trunc);
+   if (!m_Stream.is_open()) {
+      std::cout << "Recording file not open " << filePath << std::endl;
+      return false;
+   }
+
+   RecordingHeader header;
+   memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+   header.version = 1;
+   header.keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+   header.frame_floats = frame_floats;
+
+   m_Offset = 0;
+   m_KeyframeInterval = header.keyframe_interval;
+   m_SinceKeyframe = 0;
+   m_Previous.assign(frame_floats, 0.0f);
+   m_Index.clear();
+
+   write(&header, sizeof(header));
+   return true;
+}
+
+void RecordingWriter::append(const float* frame) {
+   const size_t count = m_Previous.size();
+   RecordingIndexEntry entry = { m_Offset, 0, 0 };
+
+   bool keyframe = m_Index.empty() || m_SinceKeyframe + 1 >= m_KeyframeInterval;
+   if (!keyframe) {
+      /* runs of changed values, compared bitwise so NaNs and -0.0 round trip exactly */
+      const uint32_t* current = (const uint32_t*)frame;
+      const uint32_t* previous = (const uint32_t*)m_Previous.data();
+
+      m_Delta.assign(1, 0); // run count, patched below
+      size_t i = 0;
+      while (i < count) {
+	 if (current[i] == previous[i]) {
+	    i++;
+	    continue;
+	 }
+
+	 /* extend the run over changes and over short unchanged gaps */
+	 size_t end = i + 1;
+	 size_t last_change = i;
+	 while (end < count && end - last_change <= RUN_MERGE_GAP) {
+	    if (current[end] != previous[end]) {
+	       last_change = end;
+	    }
+	    end++;
+	 }
+	 end = last_change + 1;
+
+	 m_Delta.push_back((uint32_t)i);
+	 m_Delta.push_back((uint32_t)(end - i));
+	 m_Delta.insert(m_Delta.end(), current + i, current + end);
+	 m_Delta[0]++;
+	 i = end;
+
+	 if (m_Delta.size() >= count) {
+	    keyframe = true; // not smaller than just storing the frame
+	    break;
+	 }
+      }
+   }
+
+   if (keyframe) {
+      write(frame, count * sizeof(float));
+      entry.flags = RECORDING_KEYFRAME;
+      m_SinceKeyframe = 0;
+   } else {
+      write(m_Delta.data(), m_Delta.size() * sizeof(uint32_t));
+      m_SinceKeyframe++;
+   }
+
+   entry.size = (uint32_t)(m_Offset - entry.offset);
+   m_Index.push_back(entry);
+   memcpy(m_Previous.data(), frame, count * sizeof(float));
+}
+
+void RecordingWriter::close() {
+   if (!m_Stream.is_open()) {
+      return;
+   }
+
+   /* 8-byte align the index so it can be read in place from the mapping */
+   static const unsigned char padding[8] = {};
+   write(padding, (8 - m_Offset % 8) % 8);
+
+   RecordingTrailer trailer;
+   trailer.index_offset = m_Offset;
+   trailer.frame_count = m_Index.size();
+   memcpy(trailer.magic, RECORDING_INDEX_MAGIC, sizeof(trailer.magic));
+
+   write(m_Index.data(), m_Index.size() * sizeof(RecordingIndexEntry));
+   write(&trailer, sizeof(trailer));
+   m_Stream.close();
+}
+
+///-----------///
+///- READING -///
+///-----------///
+
+RecordingRuns::RecordingRuns(const unsigned char* data, size_t size, size_t frame_floats)
+   : m_Data(data), m_Words(size / sizeof(uint32_t)), m_Word(1), m_FrameFloats(frame_floats), m_Runs(0), m_Run(0),
+     m_Damage(nullptr) {
+   if (m_Words == 0) {
+      m_Damage = "has no run count";
+      return;
+   }
+   m_Runs = word(0);
+}
+
+uint32_t RecordingRuns::word(size_t i) const {
+   uint32_t value;
+   memcpy(&value, m_Data + i * sizeof(uint32_t), sizeof(value));
+   return value;
+}
+
+bool RecordingRuns::next(uint32_t& first, uint32_t& count, const unsigned char*& values) {
+   if (m_Damage || m_Run == m_Runs) {
+      return false;
+   }
+   if (m_Words - m_Word < 2) {
+      m_Damage = "ends inside a run header";
+      return false;
+   }
+   first = word(m_Word);
+   count = word(m_Word + 1);
+   m_Word += 2;
+   if (first > m_FrameFloats || count > m_FrameFloats - first || count > m_Words - m_Word) {
+      m_Damage = "has a run outside the frame";
+      return false;
+   }
+   values = m_Data + m_Word * sizeof(uint32_t);
+   m_Word += count;
+   m_Run++;
+   return true;
+}
+
+Recording::Recording()
+   : m_Header(nullptr), m_Index(nullptr), m_FrameCount(0), m_Step(NO_STEP) {
+}
+
+bool Recording::open(const std::string& filePath) {
+   m_Header = nullptr;
+   m_Index = nullptr;
+   m_FrameCount = 0;
+   m_Step = NO_STEP;
+
+   if (!m_File.open(filePath)) {
+      return false;
+   }
+
+   const size_t size = m_File.size();
+   if (size < sizeof(RecordingHeader) + sizeof(RecordingTrailer)) {
+      std::cout << "Recording too small " << filePath << std::endl;
+      return false;
+   }
+
+   const RecordingHeader* header = (const RecordingHeader*)m_File.data();
+   const RecordingTrailer* trailer = (const RecordingTrailer*)(m_File.data() + size - sizeof(RecordingTrailer));
+   if (memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+       memcmp(trailer->magic, RECORDING_INDEX_MAGIC, sizeof(trailer->magic)) != 0) {
+      std::cout << "Not a recording, or it was never closed " << filePath << std::endl;
+      return false;
+   }
+   /* sizes first, so none of the sums below can wrap */
+   if (trailer->frame_count > size / sizeof(RecordingIndexEntry) || trailer->index_offset > size ||
+       trailer->index_offset + trailer->frame_count * sizeof(RecordingIndexEntry) + sizeof(RecordingTrailer) != size ||
+       trailer->index_offset % alignof(RecordingIndexEntry) != 0 || trailer->index_offset < sizeof(RecordingHeader) ||
+       header->frame_floats > size / sizeof(float)) {
+      std::cout << "Recording index is damaged " << filePath << std::endl;
+      return false;
+   }
+
+   /* every frame has to lie between the header and the index, keyframes have to be whole and
+    * deltas at least hold their run count */
+   const RecordingIndexEntry* index = (const RecordingIndexEntry*)(m_File.data() + trailer->index_offset);
+   for (uint64_t step = 0; step < trailer->frame_count; step++) {
+      const RecordingIndexEntry& entry = index[step];
+      const bool inside = entry.offset >= sizeof(RecordingHeader) && entry.offset <= trailer->index_offset &&
+			  entry.size <= trailer->index_offset - entry.offset;
+      const bool whole = (entry.flags & RECORDING_KEYFRAME) ? entry.size >= header->frame_floats * sizeof(float)
+							    : entry.size >= sizeof(uint32_t);
+      if (!inside || !whole) {
+	 std::cout << "Recording frame " << step << " is damaged " << filePath << std::endl;
+	 return false;
+      }
+   }
+
+   m_Header = header;
+   m_Index = index;
+   m_FrameCount = trailer->frame_count;
+   m_Frame.assign(header->frame_floats, 0.0f);
+   return true;
+}
+
+size_t Recording::keyframeBefore(size_t step) const {
+   while (step > 0 && !(m_Index[step].flags & RECORDING_KEYFRAME)) {
+      step--;
+   }
+   return step;
+}
+
+/* applies one frame on top of m_Frame, false if a delta reaches outside its payload or the frame.
+ * open() checked the entries, the runs inside a delta are only checked here */
+bool Recording::apply(size_t step) {
+   const RecordingIndexEntry& entry = m_Index[step];
+   const unsigned char* data = m_File.data() + entry.offset;
+
+   if (entry.flags & RECORDING_KEYFRAME) {
+      memcpy(m_Frame.data(), data, m_Frame.size() * sizeof(float));
+      return true;
+   }
+
+   RecordingRuns runs(data, entry.size, m_Frame.size());
+   uint32_t first, count;
+   const unsigned char* values;
+   while (runs.next(first, count, values)) {
+      memcpy(m_Frame.data() + first, values, count * sizeof(float));
+   }
+   if (runs.damage()) {
+      std::cout << "Recording frame " << step << " " << runs.damage() << std::endl;
+      return false;
+   }
+   return true;
+}
+
+const float* Recording::seek(size_t step) {
+   if (step >= m_FrameCount) {
+      return nullptr;
+   }
+   if (step == m_Step) {
+      return m_Frame.data();
+   }
+
+   const size_t keyframe = keyframeBefore(step);
+   size_t next = keyframe;
+   if (m_Step != NO_STEP && m_Step > keyframe && m_Step < step) {
+      next = m_Step + 1; // already past the keyframe, only the remaining deltas are needed
+   }
+
+   for (; next <= step; next++) {
+      if (!apply(next)) {
+	 m_Step = NO_STEP; // m_Frame is half applied, the next seek starts over from a keyframe
+	 return nullptr;
+      }
+   }
+   m_Step = step;
+   return m_Frame.data();
+}
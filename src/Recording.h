@@ -0,0 +1,123 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <stdint.h> // fixed width integers
+#include <fstream> // file stream
+#include <string> // strings!
+#include <vector>
+
+/* Simulation recording, one frame per time step, every frame is frame_floats floats.
+ *
+ *   header    RecordingHeader
+ *   frames    keyframe: frame_floats floats
+ *             delta:    uint32 run count, then per run uint32 first, uint32 count, count floats
+ *   index     RecordingIndexEntry per frame
+ *   trailer   RecordingTrailer
+ *
+ * Deltas hold the values that changed since the previous frame. A keyframe is written every
+ * keyframe_interval frames (or earlier when a delta would not be smaller), so reaching any
+ * step costs one keyframe plus fewer than keyframe_interval deltas. Native byte order. */
+
+static const char RECORDING_MAGIC[8] = { 'S', 'I', 'M', 'R', 'E', 'C', '0', '1' };
+static const char RECORDING_INDEX_MAGIC[8] = { 'S', 'I', 'M', 'R', 'I', 'D', 'X', '1' };
+
+struct RecordingHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t keyframe_interval;
+   uint64_t frame_floats;
+};
+
+struct RecordingIndexEntry {
+   uint64_t offset;	// from the start of the file
+   uint32_t size;	// in bytes
+   uint32_t flags;
+};
+
+static const uint32_t RECORDING_KEYFRAME = 1 << 0;
+
+struct RecordingTrailer {
+   uint64_t index_offset;
+   uint64_t frame_count;
+   char magic[8];
+};
+
+/* Walks the runs of a delta payload without trusting it. Every run is checked against the
+ * payload and the frame before it is handed out, and words are copied out, not cast, since
+ * payloads are not necessarily 4-byte aligned. Used by everything that reads deltas */
+class RecordingRuns {
+private:
+   const unsigned char* m_Data;
+   size_t m_Words;		// in the payload
+   size_t m_Word;		// next one to read
+   size_t m_FrameFloats;
+   uint32_t m_Runs;
+   uint32_t m_Run;
+   const char* m_Damage;	// nullptr while the runs are fine
+
+   uint32_t word(size_t i) const;
+
+public:
+   /* size is the payload's, at least the run count (Recording::open checks that) */
+   RecordingRuns(const unsigned char* data, size_t size, size_t frame_floats);
+
+   /* the next run, values point at count floats in the payload, possibly unaligned.
+    * false after the last run or at the first damaged one, damage() tells which */
+   bool next(uint32_t& first, uint32_t& count, const unsigned char*& values);
+   const char* damage() const { return m_Damage; }
+};
+
+class RecordingWriter {
+private:
+   std::ofstream m_Stream;
+   uint64_t m_Offset;
+   uint32_t m_KeyframeInterval;
+   uint32_t m_SinceKeyframe;
+   std::vector<float> m_Previous;
+   std::vector<uint32_t> m_Delta;	// staging for one delta frame, floats stored as their bits
+   std::vector<RecordingIndexEntry> m_Index;
+
+   void write(const void* data, size_t size);
+
+public:
+   RecordingWriter();
+   ~RecordingWriter(); // finishes the file if close() was not called
+
+   bool open(const std::string& filePath, size_t frame_floats, uint32_t keyframe_interval = 64);
+   void append(const float* frame);
+   /* writes the index and trailer, the file is unreadable without them */
+   void close();
+};
+
+class Recording {
+private:
+   MappedFile m_File;
+   const RecordingHeader* m_Header;
+   const RecordingIndexEntry* m_Index;
+   size_t m_FrameCount;
+
+   std::vector<float> m_Frame;	// decoded state of m_Step
+   size_t m_Step;
+
+   bool apply(size_t step);
+
+public:
+   Recording();
+
+   bool open(const std::string& filePath);
+
+   size_t frameCount() const { return m_FrameCount; }
+   size_t frameFloats() const { return m_Header ? m_Header->frame_floats : 0; }
+   const MappedFile& file() const { return m_File; }
+
+   const RecordingIndexEntry& entry(size_t step) const { return m_Index[step]; }
+   const unsigned char* payload(size_t step) const { return m_File.data() + m_Index[step].offset; }
+   size_t keyframeBefore(size_t step) const;	// the keyframe a seek to step starts from
+
+   /* Decodes the frame of a time step. Moving forward within the same keyframe interval only
+    * applies the deltas in between, anything else restarts from the step's keyframe.
+    * nullptr past the end or when a frame on the way is damaged */
+   const float* seek(size_t step);
+   size_t step() const { return m_Step; }
+};
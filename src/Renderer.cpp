@@ -0,0 +1,135 @@
+#include "Renderer.h"
+
+#include <iostream> // input/output stream
+#include <fstream> // file stream
+#include <sstream> //string stream
+
+/* :sparkles: error handler :sparkles:*/
+void GLClearError() {
+   while (glGetError() != GL_NO_ERROR);	// https://docs.gl/gl4/glGetError
+}
+
+bool GLLogCall(const char* function, const char* file, int line) {
+   while (GLenum error = glGetError()) {
+      std::cout << "[OpenGL Error]: ( " << error << " )" <<
+	 "\n\t\033[35mFunction: \033[37m" << function <<
+	 "\n\t\033[35mFile: \033[37m" << file <<
+	 "\n\t\033[35mLine: \033[37m" << line <<
+	 std::endl;
+
+      if (error == GL_INVALID_ENUM) {
+	 std::cout << "\t\033[35mInvalid: \033[37menum" << std::endl;
+      } else if (error == GL_INVALID_VALUE) {
+	 std::cout << "\t\033[35mInvalid: \033[37mvalue" << std::endl;
+      } else if (error == GL_INVALID_OPERATION) {
+	 std::cout << "\t\033[35mInvalid: \033[37moperation" << std::endl;
+      } else if (error == GL_INVALID_FRAMEBUFFER_OPERATION) {
+	 std::cout << "\t\033[35mInvalid: \033[37mframebuffer operation" << std::endl;
+      } else if (error == GL_OUT_OF_MEMORY) {
+	 std::cout << "\tOut of memory" << std::endl;
+      } else if (error == GL_STACK_UNDERFLOW) {
+	 std::cout << "\tStack underflow" << std::endl;
+      } else if (error == GL_STACK_OVERFLOW) {
+	 std::cout << "\tStack overflow" << std::endl;
+      } else {
+	 std::cout << "\tGood luck with this one ;w;" << std::endl;
+      }
+
+      std::cout << "\033[37m " << std::endl;
+      return false;
+   }
+
+   return true;
+}
+
+/* Seperates vertex and fragment shader when reading a shader file ( the ones in res/shaders ) */
+ShaderProgramSource ParseShader(const std::string& shaderFilePath) {
+   std::ifstream stream(shaderFilePath); // takes in input file
+   if (!stream.is_open()) {
+      std::cout << "Shader file not open " << shaderFilePath << std::endl;
+   }
+
+   enum class ShaderType {
+      NONE = -1, VERTEX = 0, FRAGMENT = 1
+   };
+
+   std::stringstream ss[2]; // one for vertex, one for fragments
+   std::string currentLine;
+   ShaderType type = ShaderType::NONE;
+
+   while(getline(stream, currentLine)) { // Loops through content until it condition met
+      if (currentLine.find("#shader") != std::string::npos) {
+	 if (currentLine.find("vertex") != std::string::npos) { // checks for vertex, to specify vertex
+	    type = ShaderType::VERTEX;
+	 } else if (currentLine.find("fragment") != std::string::npos) { // checks for fragment to specify fragment
+	    type = ShaderType::FRAGMENT;
+	 }
+      } else {
+	 ss[(int)type] << currentLine << '\n'; 
+      }
+   }
+
+   return { ss[0].str(), ss[1].str() };
+}
+
+std::string injectDefines(const std::string& source, const std::string& defines) {
+   size_t version = source.find("#version");
+   if (version == std::string::npos) {
+      return defines + source;
+   }
+   size_t line_end = source.find('\n', version);
+   if (line_end == std::string::npos) {
+      return source + '\n' + defines;
+   }
+   return source.substr(0, line_end + 1) + defines + source.substr(line_end + 1);
+}
+
+static unsigned int compileShader(unsigned int type, const std::string& source) {
+   GLCall(unsigned int id = glCreateShader(type));			// https://docs.gl/gl4/glCreateShader
+
+   GLCall(const char* src = source.c_str());
+
+   GLCall(glShaderSource(id, 1, &src, nullptr));			// https://docs.gl/gl4/glShaderSource
+   GLCall(glCompileShader(id));						// https://docs.gl/gl4/glCompileShader	
+
+   int shaderResult;
+
+   GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &shaderResult));		// https://docs.gl/gl4/glGetShader	
+
+   if (shaderResult == GL_FALSE){
+      int logLength;
+      GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &logLength));	// https://docs.gl/gl4/glGetShader
+
+      char* errorMessage = (char*)alloca(logLength*sizeof(char));	// https://www.geeksforgeeks.org/c/pointer-arithmetics-in-c-with-examples/
+									// https://www.man7.org/linux/man-pages/man3/alloca.3.html
+      GLCall(glGetShaderInfoLog(id, logLength, &logLength, errorMessage));	// https://docs.gl/gl4/glGetShaderInfoLog
+
+      std::cout << "CompileShader:\n\tshaderResult " <<
+	 (type == GL_VERTEX_SHADER ? "vertex: " : "fragment ")		// checks shader type
+	 <<"= GL_FALSE" << std::endl;
+      std::cout << errorMessage << std::endl;
+
+      GLCall(glDeleteShader(id));					// https://docs.gl/gl4/glDeleteShader
+
+      return 0;
+   }
+
+   return id;
+}
+
+unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader) { // Taking in source code of shaders as strings
+   GLCall(unsigned int program = glCreateProgram());	// https://docs.gl/gl4/glCreateProgram
+
+   GLCall(unsigned int vtxShader = compileShader(GL_VERTEX_SHADER, vertexShader));
+   GLCall(unsigned int frgShader = compileShader(GL_FRAGMENT_SHADER, fragmentShader));
+
+   GLCall(glAttachShader(program, vtxShader));		// https://docs.gl/gl4/glAttachShader	
+   GLCall(glAttachShader(program, frgShader));
+
+   GLCall(glLinkProgram(program));			// https://docs.gl/gl4/glLinkProgram
+   GLCall(glValidateProgram(program));			// https://docs.gl/gl4/glValidateProgram 
+
+   GLCall(glDeleteShader(vtxShader));			// https://docs.gl/gl4/glDeleteShader
+   GLCall(glDeleteShader(frgShader));
+   return program; 
+}
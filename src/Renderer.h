@@ -0,0 +1,34 @@
+//-- !!! docs.gl !!! --// gl4
+#pragma once
+
+#include "../dependencies/GLEW/glew.h"
+
+#include <string> // strings!
+#include <signal.h> // Error handler
+
+#define	ASSERT(x) do { if (!(x)) raise(SIGTRAP); } while(0)
+#define GLCall(x) GLClearError();\
+   x;\
+   ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+
+void GLClearError();
+bool GLLogCall(const char* function, const char* file, int line);
+
+struct ShaderProgramSource {
+   std::string VertexSource;
+   std::string FragmentSource;
+};
+
+ShaderProgramSource ParseShader(const std::string& shaderFilePath);
+/* puts defines (whole lines, "#define NAME 1\n") right after the #version line, which has to stay first */
+std::string injectDefines(const std::string& source, const std::string& defines);
+unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader);
+
+/* 2D camera shared by the flat views. center is in data space, zoom is how many
+ * NDC units one data unit covers, so zoom = 1 maps [-1, 1] onto the whole window */
+struct View2D {
+   float center_x = 0.0f;
+   float center_y = 0.0f;
+   float zoom = 1.0f;
+   float aspect = 1.0f; // width / height of the viewport
+};
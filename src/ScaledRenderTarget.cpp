@@ -0,0 +1,117 @@
+#include "ScaledRenderTarget.h"
+
+#include <math.h> // math
+#include <algorithm> // std::min, std::max
+
+ScaledRenderTarget::ScaledRenderTarget(int window_width, int window_height)
+   : m_QueryFrame(0), m_WindowWidth(0), m_WindowHeight(0), m_RenderedWidth(0), m_RenderedHeight(0),
+     m_Scale(1.0f), m_GpuMilliseconds(0.0f) {
+   GLCall(glGenFramebuffers(1, &m_Framebuffer));		// https://docs.gl/gl4/glGenFramebuffers
+   GLCall(glGenRenderbuffers(1, &m_ColorBuffer));		// https://docs.gl/gl4/glGenRenderbuffers
+   GLCall(glGenRenderbuffers(1, &m_DepthBuffer));
+   GLCall(glGenQueries(QUERY_COUNT, m_TimerQueries));		// https://docs.gl/gl4/glGenQueries
+   for (int i = 0; i < QUERY_COUNT; i++) {
+      m_QueryPending[i] = false;
+   }
+
+   resize(window_width, window_height);
+}
+
+ScaledRenderTarget::~ScaledRenderTarget() {
+   glDeleteQueries(QUERY_COUNT, m_TimerQueries);
+   glDeleteRenderbuffers(1, &m_DepthBuffer);
+   glDeleteRenderbuffers(1, &m_ColorBuffer);
+   glDeleteFramebuffers(1, &m_Framebuffer);
+}
+
+void ScaledRenderTarget::resize(int window_width, int window_height) {
+   window_width = std::max(1, window_width);	// minimized windows report 0x0
+   window_height = std::max(1, window_height);
+   if (window_width == m_WindowWidth && window_height == m_WindowHeight) {
+      return;
+   }
+   m_WindowWidth = window_width;
+   m_WindowHeight = window_height;
+
+   GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer));
+   GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_WindowWidth, m_WindowHeight));	// https://docs.gl/gl4/glRenderbufferStorage
+   GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer));
+   GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_WindowWidth, m_WindowHeight));
+   GLCall(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+   GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer));
+   GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer));	// https://docs.gl/gl4/glFramebufferRenderbuffer
+   GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer));
+   GLCall(GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+   ASSERT(status == GL_FRAMEBUFFER_COMPLETE);
+   GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+void ScaledRenderTarget::begin() {
+   m_RenderedWidth = width();
+   m_RenderedHeight = height();
+   GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer));	// https://docs.gl/gl4/glBindFramebuffer
+   GLCall(glViewport(0, 0, m_RenderedWidth, m_RenderedHeight));	// https://docs.gl/gl4/glViewport
+
+   /* glClear ignores the viewport, the scissor keeps it inside the part we use */
+   GLCall(glEnable(GL_SCISSOR_TEST));
+   GLCall(glScissor(0, 0, m_RenderedWidth, m_RenderedHeight));
+
+   if (!m_QueryPending[m_QueryFrame]) {
+      GLCall(glBeginQuery(GL_TIME_ELAPSED, m_TimerQueries[m_QueryFrame]));	// https://docs.gl/gl4/glBeginQuery
+   }
+}
+
+void ScaledRenderTarget::end() {
+   if (!m_QueryPending[m_QueryFrame]) {
+      GLCall(glEndQuery(GL_TIME_ELAPSED));
+      m_QueryPending[m_QueryFrame] = true;
+   }
+   GLCall(glDisable(GL_SCISSOR_TEST));
+
+   /* upscale into the window */
+   GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Framebuffer));
+   GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+   GLCall(glBlitFramebuffer(0, 0, m_RenderedWidth, m_RenderedHeight, 0, 0, m_WindowWidth, m_WindowHeight,	// https://docs.gl/gl4/glBlitFramebuffer
+			    GL_COLOR_BUFFER_BIT, m_Scale < 1.0f ? GL_LINEAR : GL_NEAREST));
+   GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+   GLCall(glViewport(0, 0, m_WindowWidth, m_WindowHeight));
+
+   /* oldest query first, results that are not there yet are just picked up next frame */
+   m_QueryFrame = (m_QueryFrame + 1) % QUERY_COUNT;
+   for (int i = 0; i < QUERY_COUNT; i++) {
+      const int query = (m_QueryFrame + i) % QUERY_COUNT;
+      if (!m_QueryPending[query]) {
+	 continue;
+      }
+
+      GLint available = 0;
+      GLCall(glGetQueryObjectiv(m_TimerQueries[query], GL_QUERY_RESULT_AVAILABLE, &available));	// https://docs.gl/gl4/glGetQueryObject
+      if (!available) {
+	 break;
+      }
+
+      GLuint64 nanoseconds = 0;
+      GLCall(glGetQueryObjectui64v(m_TimerQueries[query], GL_QUERY_RESULT, &nanoseconds));
+      m_QueryPending[query] = false;
+      m_GpuMilliseconds = nanoseconds / 1.0e6f;
+      adjustScale(m_GpuMilliseconds);
+   }
+}
+
+/* Fill rate bound frames cost roughly scale^2, so the scale that hits the target is
+ * scale * sqrt(target / measured). Only part of the way is taken per measurement and small
+ * errors are ignored, otherwise the resolution visibly pumps up and down. */
+void ScaledRenderTarget::adjustScale(float gpu_milliseconds) {
+   if (gpu_milliseconds <= 0.0f) {
+      return;
+   }
+
+   const float ratio = target_milliseconds / gpu_milliseconds;
+   if (ratio > 0.9f && ratio < 1.1f) {
+      return;
+   }
+
+   const float ideal = m_Scale * sqrtf(ratio);
+   m_Scale = std::min(max_scale, std::max(min_scale, m_Scale + 0.5f * (ideal - m_Scale)));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Renderer.h"
+
+/* Offscreen color and depth target whose resolution follows the measured gpu frame time.
+ * Storage is allocated at full window size once and frames render into the lower-left
+ * scale * size corner of it, so changing the scale never reallocates anything.
+ * end() upscales that corner into the window with a linear blit. */
+class ScaledRenderTarget {
+private:
+   static const int QUERY_COUNT = 4; // results are read a few frames late so we never wait on the gpu
+
+   unsigned int m_Framebuffer;
+   unsigned int m_ColorBuffer;
+   unsigned int m_DepthBuffer;	// same size, only color is blitted to the window
+   unsigned int m_TimerQueries[QUERY_COUNT];
+   bool m_QueryPending[QUERY_COUNT];
+   int m_QueryFrame;
+
+   int m_WindowWidth, m_WindowHeight;
+   int m_RenderedWidth, m_RenderedHeight;	// size of the frame begin() started, end() may change the scale
+   float m_Scale;
+   float m_GpuMilliseconds;	// latest measurement
+
+   void adjustScale(float gpu_milliseconds);
+
+public:
+   float target_milliseconds = 12.0f;	// leaves headroom under a 60 Hz frame
+   float min_scale = 0.25f;
+   float max_scale = 1.0f;
+
+   ScaledRenderTarget(int window_width, int window_height);
+   ~ScaledRenderTarget();
+
+   ScaledRenderTarget(const ScaledRenderTarget&) = delete;
+   ScaledRenderTarget& operator=(const ScaledRenderTarget&) = delete;
+
+   /* call from the framebuffer size callback (or after it), sizes are in pixels */
+   void resize(int window_width, int window_height);
+
+   /* binds the target and sets the viewport to the current scaled size */
+   void begin();
+   /* upscales into the default framebuffer and feeds the timer back into the scale */
+   void end();
+
+   /* holds the last frame until the next begin(), for reading it back */
+   unsigned int framebuffer() const { return m_Framebuffer; }
+   float scale() const { return m_Scale; }
+   float gpuMilliseconds() const { return m_GpuMilliseconds; }
+   int width() const { return (int)(m_WindowWidth * m_Scale + 0.5f); }
+   int height() const { return (int)(m_WindowHeight * m_Scale + 0.5f); }
+   /* the part of framebuffer() the last frame was drawn into, width() and height() are
+    * already the next frame's after end() */
+   int renderedWidth() const { return m_RenderedWidth; }
+   int renderedHeight() const { return m_RenderedHeight; }
+};
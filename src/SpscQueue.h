@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h> // size_t
+#include <vector>
+
+/* Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ * Neither side ever blocks, push fails when full and pop fails when empty. */
+template<typename T>
+class SpscQueue {
+private:
+   std::vector<T> m_Slots;
+   size_t m_Mask;
+
+   /* separate cache lines, otherwise the two threads keep stealing the line from each other */
+   alignas(64) std::atomic<size_t> m_Head;	// next slot to pop, written by the consumer
+   alignas(64) std::atomic<size_t> m_Tail;	// next slot to push, written by the producer
+
+public:
+   /* capacity is rounded up to a power of two */
+   explicit SpscQueue(size_t capacity)
+      : m_Head(0), m_Tail(0) {
+      reset(capacity);
+   }
+
+   /* empties and resizes the queue, only while neither side is using it */
+   void reset(size_t capacity) {
+      size_t size = 1;
+      while (size < capacity) {
+	 size <<= 1;
+      }
+      m_Slots.assign(size, T());
+      m_Mask = size - 1;
+      m_Head.store(0);
+      m_Tail.store(0);
+   }
+
+   bool push(const T& value) {
+      const size_t tail = m_Tail.load(std::memory_order_relaxed);
+      if (tail - m_Head.load(std::memory_order_acquire) > m_Mask) {
+	 return false;
+      }
+      m_Slots[tail & m_Mask] = value;
+      m_Tail.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool pop(T& value) {
+      const size_t head = m_Head.load(std::memory_order_relaxed);
+      if (head == m_Tail.load(std::memory_order_acquire)) {
+	 return false;
+      }
+      value = m_Slots[head & m_Mask];
+      m_Head.store(head + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool empty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire); }
+   size_t capacity() const { return m_Mask + 1; }
+};
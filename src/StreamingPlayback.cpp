@@ -0,0 +1,164 @@
+#include "StreamingPlayback.h"
+
+#include <iostream> // input/output stream
+#include <string.h> // memcpy
+#include <sys/mman.h> // madvise
+#include <algorithm> // std::min, std::max
+
+static const size_t NO_STEP = (size_t)-1;
+
+bool uploadRecordingFrame(GLenum target, const RecordingIndexEntry& entry, const unsigned char* data, size_t frame_floats) {
+   if (entry.flags & RECORDING_KEYFRAME) {
+      if (entry.size < frame_floats * sizeof(float)) {
+	 return false;
+      }
+      GLCall(glBufferSubData(target, 0, frame_floats * sizeof(float), data));	// the buffer is one frame, never more
+      return true;
+   }
+
+   /* one mapping spanning every run instead of one glBufferSubData per run, so the runs are
+    * walked twice: checked and measured first, nothing is written for a damaged frame */
+   uint32_t first, count;
+   const unsigned char* values;
+   size_t begin = frame_floats, end = 0;
+   RecordingRuns measure(data, entry.size, frame_floats);
+   while (measure.next(first, count, values)) {
+      if (count > 0) {
+	 begin = std::min(begin, (size_t)first);
+	 end = std::max(end, (size_t)first + count);
+      }
+   }
+   if (measure.damage()) {
+      return false;
+   }
+   if (begin >= end) {
+      return true; // nothing changed
+   }
+
+   GLCall(unsigned char* mapped = (unsigned char*)glMapBufferRange(target,	// https://docs.gl/gl4/glMapBufferRange
+								   begin * sizeof(float), (end - begin) * sizeof(float),
+								   GL_MAP_WRITE_BIT));
+   if (!mapped) {
+      return false;
+   }
+   RecordingRuns runs(data, entry.size, frame_floats);
+   while (runs.next(first, count, values)) {
+      memcpy(mapped + (first - begin) * sizeof(float), values, count * sizeof(float));
+   }
+   GLCall(glUnmapBuffer(target));
+   return true;
+}
+
+StreamingPlayback::StreamingPlayback()
+   : m_Step(NO_STEP), m_Direction(1), m_ReadaheadBytes(0), m_FramesBegin(0), m_FramesEnd(0),
+     m_ResidentBegin(0), m_ResidentEnd(0) {
+   GLCall(glGenBuffers(1, &m_Buffer));
+}
+
+StreamingPlayback::~StreamingPlayback() {
+   glDeleteBuffers(1, &m_Buffer);
+}
+
+bool StreamingPlayback::open(const std::string& filePath, size_t readahead_bytes) {
+   m_Step = NO_STEP;
+   if (!m_Recording.open(filePath) || m_Recording.frameCount() == 0) {
+      return false;
+   }
+
+   const RecordingIndexEntry& last = m_Recording.entry(m_Recording.frameCount() - 1);
+   m_FramesBegin = m_Recording.entry(0).offset;
+   m_FramesEnd = last.offset + last.size;
+   m_ReadaheadBytes = std::max(readahead_bytes, (size_t)m_Recording.frameFloats() * sizeof(float));
+   m_ResidentBegin = m_ResidentEnd = m_FramesBegin;
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer));
+   GLCall(glBufferData(GL_COPY_WRITE_BUFFER, m_Recording.frameFloats() * sizeof(float), nullptr, GL_STREAM_DRAW));
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+   setDirection(1);
+   return true;
+}
+
+void StreamingPlayback::setDirection(int direction) {
+   m_Direction = direction < 0 ? -1 : 1;
+
+   /* the kernel's own readahead only goes forward, in reverse our WILLNEED window does the work */
+   m_Recording.file().advise(0, m_Recording.file().size(), m_Direction > 0 ? MADV_SEQUENTIAL : MADV_NORMAL);
+}
+
+bool StreamingPlayback::advance() {
+   if (m_Step == NO_STEP) {
+      return show(m_Direction > 0 ? 0 : frameCount() - 1);
+   }
+   if ((m_Direction > 0 && m_Step + 1 >= frameCount()) || (m_Direction < 0 && m_Step == 0)) {
+      return false;
+   }
+
+   return show(m_Step + m_Direction);
+}
+
+bool StreamingPlayback::show(size_t step) {
+   if (step >= frameCount()) {
+      return false;
+   }
+   if (step == m_Step) {
+      return true;
+   }
+
+   const size_t keyframe = m_Recording.keyframeBefore(step);
+   size_t next = keyframe;
+   if (m_Step != NO_STEP && m_Step > keyframe && m_Step < step) {
+      next = m_Step + 1; // the buffer already holds everything up to m_Step
+   }
+
+   m_Step = step;
+   updateResidentWindow(); // before touching the pages, so the readahead is already in flight
+
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer));
+   for (; next <= step; next++) {
+      if (!uploadRecordingFrame(GL_COPY_WRITE_BUFFER, m_Recording.entry(next), m_Recording.payload(next), frameFloats())) { // straight out of the page cache
+	 std::cout << "Recording frame " << next << " is damaged" << std::endl;
+	 m_Step = NO_STEP; // the buffer is half updated, the next show starts over from a keyframe
+	 break;
+      }
+   }
+   GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+   return m_Step != NO_STEP;
+}
+
+/* Keeps [keyframe of the playhead, readahead in the playback direction] resident. Syscalls
+ * only happen once the playhead moved a quarter window, not every frame. */
+void StreamingPlayback::updateResidentWindow() {
+   const MappedFile& file = m_Recording.file();
+   const size_t keyframe_offset = m_Recording.entry(m_Recording.keyframeBefore(m_Step)).offset;
+   const RecordingIndexEntry& current = m_Recording.entry(m_Step);
+
+   size_t begin, end;
+   if (m_Direction > 0) {
+      begin = keyframe_offset;
+      end = std::min(m_FramesEnd, current.offset + current.size + m_ReadaheadBytes);
+   } else {
+      begin = keyframe_offset > m_FramesBegin + m_ReadaheadBytes ? keyframe_offset - m_ReadaheadBytes : m_FramesBegin;
+      end = current.offset + current.size;
+   }
+
+   const size_t slack = m_ReadaheadBytes / 4;
+   const bool covered = begin >= m_ResidentBegin && end <= m_ResidentEnd;
+   const bool close_enough = covered && (m_Direction > 0 ? m_ResidentEnd - end : begin - m_ResidentBegin) > slack;
+   if (close_enough && m_ResidentEnd - m_ResidentBegin <= 2 * m_ReadaheadBytes + slack) {
+      return;
+   }
+
+   /* release what fell out of the window, then request the window */
+   if (m_ResidentBegin < begin) {
+      file.advise(m_ResidentBegin, std::min(begin, m_ResidentEnd) - m_ResidentBegin, MADV_DONTNEED);
+   }
+   if (m_ResidentEnd > end) {
+      const size_t from = std::max(end, m_ResidentBegin);
+      file.advise(from, m_ResidentEnd - from, MADV_DONTNEED);
+   }
+   file.advise(begin, end - begin, MADV_WILLNEED);
+
+   m_ResidentBegin = begin;
+   m_ResidentEnd = end;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Recording.h"
+
+/* Applies one recorded frame (keyframe or delta) to the buffer bound to target, which holds
+ * frame_floats floats. data is the frame's payload, wherever it lives: the mapping, or a buffer
+ * it was read into. false when the frame is damaged, a delta then writes nothing */
+bool uploadRecordingFrame(GLenum target, const RecordingIndexEntry& entry, const unsigned char* data, size_t frame_floats);
+
+/* Plays a recording that can be far larger than RAM at constant memory. The file stays mapped,
+ * only a window of it around the playhead is kept resident: pages ahead (in the playback
+ * direction) are requested with MADV_WILLNEED, pages behind are released with MADV_DONTNEED.
+ * Frames are uploaded with the mapping itself as the source, there is no staging copy. */
+class StreamingPlayback {
+private:
+   Recording m_Recording;
+   unsigned int m_Buffer;
+   size_t m_Step;
+   int m_Direction;		// +1 forward, -1 backward
+
+   size_t m_ReadaheadBytes;
+   size_t m_FramesBegin, m_FramesEnd;	// byte range of the frame data in the file
+   size_t m_ResidentBegin, m_ResidentEnd;	// what is currently advised WILLNEED
+
+   void updateResidentWindow();
+
+public:
+   StreamingPlayback();
+   ~StreamingPlayback();
+
+   StreamingPlayback(const StreamingPlayback&) = delete;
+   StreamingPlayback& operator=(const StreamingPlayback&) = delete;
+
+   /* readahead_bytes is how far ahead of the playhead pages are requested */
+   bool open(const std::string& filePath, size_t readahead_bytes = 256u << 20);
+
+   void setDirection(int direction);
+   int direction() const { return m_Direction; }
+
+   /* Moves one step in the playback direction, false at either end of the recording or on a damaged frame */
+   bool advance();
+   /* Jumps to any step. Following steps forward only uploads the deltas in between,
+    * everything else uploads the step's keyframe and the deltas after it.
+    * false past the end or when a frame on the way is damaged, no step is shown then */
+   bool show(size_t step);
+
+   /* GL_ARRAY_BUFFER (or anything else) with the current frame, frameFloats() floats */
+   unsigned int buffer() const { return m_Buffer; }
+   size_t step() const { return m_Step; }
+   size_t frameCount() const { return m_Recording.frameCount(); }
+   size_t frameFloats() const { return m_Recording.frameFloats(); }
+};
@@ -0,0 +1,139 @@
+#include "VectorField.h"
+
+#include <math.h> // math
+#include <algorithm> // std::min, std::max
+
+static const int ARROW_VERTICES = 9; // must match the arrow[] table in vector_field.shader
+
+VectorField::VectorField(const std::string& shaderFilePath)
+   : m_VertexArray([] {
+	/* both attributes advance once per arrow instead of once per vertex, pointers are set per draw */
+	GLCall(glEnableVertexAttribArray(0));
+	GLCall(glEnableVertexAttribArray(1));
+	GLCall(glVertexAttribDivisor(0, 1));			// https://docs.gl/gl4/glVertexAttribDivisor
+	GLCall(glVertexAttribDivisor(1, 1));
+     }),
+     m_SampleCount(0), m_BufferCapacity(0), m_GridWidth(0), m_OriginX(0.0f), m_OriginY(0.0f),
+     m_Spacing(1.0f), m_MaxMagnitude(1.0f), m_MaxStride(1) {
+   ShaderProgramSource source = ParseShader(shaderFilePath);
+   m_Shader = createShader(source.VertexSource, source.FragmentSource);
+   checkVertexInputs<FieldSample>(m_Shader, "FieldSample");
+
+   GLCall(m_CenterLocation = glGetUniformLocation(m_Shader, "u_Center"));
+   GLCall(m_ScaleLocation = glGetUniformLocation(m_Shader, "u_Scale"));
+   GLCall(m_GlyphLengthLocation = glGetUniformLocation(m_Shader, "u_GlyphLength"));
+   GLCall(m_InvMaxMagnitudeLocation = glGetUniformLocation(m_Shader, "u_InvMaxMagnitude"));
+
+   GLCall(glGenBuffers(1, &m_SampleBuffer));
+
+   /* the stride trick below is bounded by the largest stride the driver accepts */
+   int max_stride_bytes = 2048; // spec minimum, GL_MAX_VERTEX_ATTRIB_STRIDE only exists from 4.4
+   if (GLEW_VERSION_4_4) {
+      GLCall(glGetIntegerv(GL_MAX_VERTEX_ATTRIB_STRIDE, &max_stride_bytes));	// https://docs.gl/gl4/glGet
+   }
+   m_MaxStride = std::max(1, max_stride_bytes / (int)sizeof(FieldSample));
+}
+
+VectorField::~VectorField() {
+   glDeleteBuffers(1, &m_SampleBuffer);		// https://docs.gl/gl4/glDeleteBuffers
+   glDeleteProgram(m_Shader);
+}
+
+void VectorField::setSamples(const FieldSample* samples, unsigned int count, unsigned int grid_width,
+			     float spacing, float max_magnitude) {
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_SampleBuffer));
+   if (count != m_BufferCapacity) {
+      GLCall(glBufferData(GL_ARRAY_BUFFER, count * sizeof(FieldSample), samples, GL_DYNAMIC_DRAW));
+      m_BufferCapacity = count;
+   } else {
+      GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(FieldSample), samples));	// https://docs.gl/gl4/glBufferSubData
+   }
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+   m_SampleCount = count;
+   m_GridWidth = grid_width;
+   m_Spacing = spacing > 0.0f ? spacing : 1.0f;
+   m_MaxMagnitude = max_magnitude > 0.0f ? max_magnitude : 1.0f;
+   if (count > 0) {
+      m_OriginX = samples[0].x;
+      m_OriginY = samples[0].y;
+   }
+}
+
+unsigned int VectorField::strideForView(const View2D& view, int viewport_width) const {
+   /* on-screen distance between two neighbouring samples, ndc -> pixels is width / 2 */
+   float spacing_pixels = m_Spacing * view.zoom / view.aspect * viewport_width * 0.5f;
+   if (spacing_pixels <= 0.0f) {
+      return m_MaxStride;
+   }
+
+   unsigned int k = (unsigned int)ceilf(min_glyph_pixels / spacing_pixels);
+   if (m_GridWidth == 0) {
+      /* scattered samples thin out in both directions at once, so 1 of k*k keeps the same density */
+      k = k * k;
+   }
+   return std::min(std::max(k, 1u), m_MaxStride);
+}
+
+/* Points both instance attributes at first_sample and makes them skip stride - 1 samples per
+ * instance, this is how samples get dropped without touching the buffer contents */
+void VectorField::bindSamples(unsigned int first_sample, unsigned int stride) {
+   applyVertexLayout<FieldSample>(first_sample * sizeof(FieldSample), stride);
+}
+
+void VectorField::draw(const View2D& view, int viewport_width) {
+   if (m_SampleCount == 0) {
+      return;
+   }
+
+   const unsigned int k = strideForView(view, viewport_width);
+   /* glyphs are spaced k samples apart per axis, for scattered samples k is the stride over both */
+   const float axis_stride = m_GridWidth == 0 ? sqrtf((float)k) : (float)k;
+   const float scale_x = view.zoom / view.aspect;
+   const float scale_y = view.zoom;
+
+   GLCall(glUseProgram(m_Shader));
+   GLCall(glUniform2f(m_CenterLocation, view.center_x, view.center_y));
+   GLCall(glUniform2f(m_ScaleLocation, scale_x, scale_y));
+   GLCall(glUniform1f(m_GlyphLengthLocation, 0.9f * axis_stride * m_Spacing));	// arrows never overlap their neighbour
+   GLCall(glUniform1f(m_InvMaxMagnitudeLocation, 1.0f / m_MaxMagnitude));
+
+   m_VertexArray.bind();
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_SampleBuffer));
+
+   if (m_GridWidth == 0) {
+      /* scattered samples: one instanced draw over every k-th sample */
+      bindSamples(0, k);
+      GLCall(glDrawArraysInstanced(GL_TRIANGLES, 0, ARROW_VERTICES, (m_SampleCount + k - 1) / k));	// https://docs.gl/gl4/glDrawArraysInstanced
+   } else {
+      /* grids: only the visible rows and columns, one instanced draw per kept row. The number
+       * of rows drawn is bounded by the viewport height / min_glyph_pixels, not by the grid size */
+      const unsigned int rows = m_SampleCount / m_GridWidth;
+      const float margin = k * m_Spacing; // arrows just outside the view still reach into it
+
+      const float min_x = view.center_x - 1.0f / scale_x - margin;
+      const float max_x = view.center_x + 1.0f / scale_x + margin;
+      const float min_y = view.center_y - 1.0f / scale_y - margin;
+      const float max_y = view.center_y + 1.0f / scale_y + margin;
+
+      int first_col = std::max(0, (int)floorf((min_x - m_OriginX) / m_Spacing));
+      int last_col = std::min((int)m_GridWidth - 1, (int)ceilf((max_x - m_OriginX) / m_Spacing));
+      int first_row = std::max(0, (int)floorf((min_y - m_OriginY) / m_Spacing));
+      int last_row = std::min((int)rows - 1, (int)ceilf((max_y - m_OriginY) / m_Spacing));
+
+      /* snap to multiples of k so glyphs do not swim around while panning */
+      first_col -= first_col % k;
+      first_row -= first_row % k;
+
+      if (first_col <= last_col) {
+	 const unsigned int columns = (last_col - first_col) / k + 1;
+	 for (int row = first_row; row <= last_row; row += k) {
+	    bindSamples(row * m_GridWidth + first_col, k);
+	    GLCall(glDrawArraysInstanced(GL_TRIANGLES, 0, ARROW_VERTICES, columns));
+	 }
+      }
+   }
+
+   GLCall(glBindVertexArray(0));
+   GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
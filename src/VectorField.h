@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Renderer.h"
+#include "Views.h"
+#include "VertexLayout.h"
+
+/* One sample of a 2D vector field, this is also the per-instance layout on the gpu */
+struct FieldSample {
+   float x, y;		// position in data space
+   float vx, vy;	// vector at that position
+};
+
+template<> struct VertexFormat<FieldSample> {
+   static constexpr VertexAttribute attributes[] = {
+      VERTEX_ATTRIBUTE_RUN(FieldSample, x, y, 0, "sample_position", ATTRIBUTE_FLOAT),
+      VERTEX_ATTRIBUTE_RUN(FieldSample, vx, vy, 1, "sample_vector", ATTRIBUTE_FLOAT),
+   };
+};
+
+/* Draws one arrow glyph per sample. The arrow itself is expanded in the vertex shader
+ * from gl_VertexID, so the only thing living in memory is the sample buffer.
+ * When zoomed out only 1 of every k samples (per axis for grids) is drawn, where k is
+ * picked so glyphs stay at least min_glyph_pixels apart on screen. */
+class VectorField {
+private:
+   ContextVertexArray m_VertexArray;
+   unsigned int m_SampleBuffer;
+   unsigned int m_Shader;
+
+   int m_CenterLocation;
+   int m_ScaleLocation;
+   int m_GlyphLengthLocation;
+   int m_InvMaxMagnitudeLocation;
+
+   unsigned int m_SampleCount;
+   unsigned int m_BufferCapacity;	// in samples
+   unsigned int m_GridWidth;		// samples per row, 0 for scattered samples
+   float m_OriginX, m_OriginY;		// position of sample 0 on a grid
+   float m_Spacing;			// data-space distance between neighbouring samples
+   float m_MaxMagnitude;
+   unsigned int m_MaxStride;		// largest k the attribute stride allows
+
+   void bindSamples(unsigned int first_sample, unsigned int stride);
+
+public:
+   float min_glyph_pixels = 14.0f;
+
+   VectorField(const std::string& shaderFilePath = "../res/shaders/vector_field.shader");
+   ~VectorField();
+
+   VectorField(const VectorField&) = delete;
+   VectorField& operator=(const VectorField&) = delete;
+
+   /* Uploads a time step. grid_width is the row length of a structured grid (rows run
+    * along +y) or 0 for scattered samples, spacing is the typical distance between samples.
+    * Re-uploading the same sample count reuses the buffer storage. */
+   void setSamples(const FieldSample* samples, unsigned int count, unsigned int grid_width,
+		   float spacing, float max_magnitude);
+
+   /* 1 of every k samples is drawn at this zoom level */
+   unsigned int strideForView(const View2D& view, int viewport_width) const;
+
+   void draw(const View2D& view, int viewport_width);
+};
@@ -0,0 +1,89 @@
+#include "VertexLayout.h"
+
+#include <iostream> // input/output stream
+#include <string.h> // strcmp, strncmp
+
+void applyVertexAttributes(const VertexAttribute* attributes, size_t count, GLsizei stride, size_t base_offset) {
+   for (size_t i = 0; i < count; i++) {
+      const VertexAttribute& attribute = attributes[i];
+      const void* pointer = (const void*)(base_offset + attribute.offset);
+
+      GLCall(glEnableVertexAttribArray(attribute.location));	// https://docs.gl/gl4/glEnableVertexAttribArray
+      if (attribute.mode == ATTRIBUTE_INTEGER) {
+	 GLCall(glVertexAttribIPointer(attribute.location, attribute.components, attribute.type, stride, pointer));	// https://docs.gl/gl4/glVertexAttribPointer
+      } else {
+	 const GLboolean normalized = attribute.mode == ATTRIBUTE_NORMALIZED ? GL_TRUE : GL_FALSE;
+	 GLCall(glVertexAttribPointer(attribute.location, attribute.components, attribute.type, normalized, stride, pointer));
+      }
+   }
+}
+
+/* components and int-ness of an active attribute's type, as glGetActiveAttrib reports it */
+static bool inputShape(GLenum type, int& components, bool& integer) {
+   switch (type) {
+   case GL_FLOAT:             components = 1; integer = false; return true;
+   case GL_FLOAT_VEC2:        components = 2; integer = false; return true;
+   case GL_FLOAT_VEC3:        components = 3; integer = false; return true;
+   case GL_FLOAT_VEC4:        components = 4; integer = false; return true;
+   case GL_INT:               components = 1; integer = true;  return true;
+   case GL_INT_VEC2:          components = 2; integer = true;  return true;
+   case GL_INT_VEC3:          components = 3; integer = true;  return true;
+   case GL_INT_VEC4:          components = 4; integer = true;  return true;
+   case GL_UNSIGNED_INT:      components = 1; integer = true;  return true;
+   case GL_UNSIGNED_INT_VEC2: components = 2; integer = true;  return true;
+   case GL_UNSIGNED_INT_VEC3: components = 3; integer = true;  return true;
+   case GL_UNSIGNED_INT_VEC4: components = 4; integer = true;  return true;
+   default:                   return false;	// matrices and doubles, nothing here feeds those
+   }
+}
+
+bool checkVertexInputs(unsigned int program, const VertexAttribute* attributes, size_t count, const char* format_name) {
+   bool valid = true;
+
+   GLint active = 0;
+   GLCall(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active));	// https://docs.gl/gl4/glGetProgram
+   for (GLint i = 0; i < active; i++) {
+      char name[128];
+      GLint size;
+      GLenum type;
+      GLCall(glGetActiveAttrib(program, i, sizeof(name), nullptr, &size, &type, name));	// https://docs.gl/gl4/glGetActiveAttrib
+      if (strncmp(name, "gl_", 3) == 0) {
+	 continue; // gl_VertexID and friends are not fed from buffers
+      }
+
+      const VertexAttribute* attribute = nullptr;
+      for (size_t a = 0; a < count; a++) {
+	 if (strcmp(attributes[a].name, name) == 0) {
+	    attribute = &attributes[a];
+	 }
+      }
+      if (!attribute) {
+	 std::cout << "[VertexLayout]: " << format_name << " has nothing for shader input " << name << std::endl;
+	 valid = false;
+	 continue;
+      }
+
+      GLCall(GLint location = glGetAttribLocation(program, name));	// https://docs.gl/gl4/glGetAttribLocation
+      int components;
+      bool integer;
+      if (location != (GLint)attribute->location) {
+	 std::cout << "[VertexLayout]: " << format_name << " feeds " << name << " at location " << attribute->location
+		   << ", the shader has it at " << location << std::endl;
+	 valid = false;
+      } else if (!inputShape(type, components, integer)) {
+	 std::cout << "[VertexLayout]: " << name << " has a type vertex layouts do not describe" << std::endl;
+	 valid = false;
+      } else if (integer != (attribute->mode == ATTRIBUTE_INTEGER)) {
+	 std::cout << "[VertexLayout]: " << name << (integer ? " is an int input, it needs ATTRIBUTE_INTEGER"
+						   : " is a float input, ATTRIBUTE_INTEGER cannot feed it") << std::endl;
+	 valid = false;
+      } else if (attribute->components > components) {
+	 /* fewer is fine, GL fills in (0, 0, 0, 1). More is fetched for nothing */
+	 std::cout << "[VertexLayout]: " << format_name << " feeds " << attribute->components << " components to "
+		   << name << ", the shader reads " << components << std::endl;
+	 valid = false;
+      }
+   }
+
+   return valid;
+}
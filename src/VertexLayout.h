@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Renderer.h"
+
+#include <stddef.h> // offsetof, size_t
+#include <stdint.h> // fixed width integers
+#include <type_traits> // std::remove_all_extents
+
+/* how the shader sees an attribute's components */
+enum VertexAttributeMode {
+   ATTRIBUTE_FLOAT = 0,		// converted to float as is
+   ATTRIBUTE_NORMALIZED,	// integers mapped to [0, 1] or [-1, 1]
+   ATTRIBUTE_INTEGER,		// stays an int / uint in the shader, glVertexAttribIPointer
+   ATTRIBUTE_HALF,		// uint16_t storage holding IEEE half floats
+};
+
+struct VertexAttribute {
+   unsigned int location;
+   const char* name;	// the shader input it feeds
+   int components;
+   GLenum type;
+   VertexAttributeMode mode;
+   size_t offset;
+   size_t bytes;
+};
+
+/* GL type of one component of a C++ member */
+template<typename T> struct VertexComponentType;
+template<> struct VertexComponentType<float>    { static constexpr GLenum type = GL_FLOAT; };
+template<> struct VertexComponentType<double>   { static constexpr GLenum type = GL_DOUBLE; };
+template<> struct VertexComponentType<int8_t>   { static constexpr GLenum type = GL_BYTE; };
+template<> struct VertexComponentType<uint8_t>  { static constexpr GLenum type = GL_UNSIGNED_BYTE; };
+template<> struct VertexComponentType<int16_t>  { static constexpr GLenum type = GL_SHORT; };
+template<> struct VertexComponentType<uint16_t> { static constexpr GLenum type = GL_UNSIGNED_SHORT; };
+template<> struct VertexComponentType<int32_t>  { static constexpr GLenum type = GL_INT; };
+template<> struct VertexComponentType<uint32_t> { static constexpr GLenum type = GL_UNSIGNED_INT; };
+
+/* Describes one member, components and GL type come from its declared type (float[3] is
+ * 3 x GL_FLOAT), so the description cannot drift from the struct. Use VERTEX_ATTRIBUTE. */
+template<typename Member, VertexAttributeMode Mode>
+constexpr VertexAttribute vertexAttribute(unsigned int location, const char* name, size_t offset) {
+   using Component = typename std::remove_all_extents<Member>::type;
+   constexpr bool is_float = std::is_floating_point<Component>::value;
+
+   static_assert(sizeof(Member) / sizeof(Component) >= 1 && sizeof(Member) / sizeof(Component) <= 4,
+		 "vertex attributes have 1 to 4 components");
+   static_assert(Mode == ATTRIBUTE_FLOAT || !is_float, "only integer members can be normalized or integer attributes");
+   static_assert(Mode != ATTRIBUTE_HALF || std::is_same<Component, uint16_t>::value, "half floats are stored as uint16_t");
+
+   return { location, name, (int)(sizeof(Member) / sizeof(Component)),
+	    Mode == ATTRIBUTE_HALF ? (GLenum)GL_HALF_FLOAT : VertexComponentType<Component>::type,
+	    Mode, offset, sizeof(Member) };
+}
+
+/* the same for a run of scalar members, x, y, z declared one after another */
+template<typename First, typename Last, size_t Count, VertexAttributeMode Mode>
+constexpr VertexAttribute vertexAttributeRun(unsigned int location, const char* name, size_t offset) {
+   static_assert(std::is_same<First, Last>::value, "a run of members has to share one type");
+   return vertexAttribute<First[Count], Mode>(location, name, offset);
+}
+
+#define VERTEX_ATTRIBUTE(Vertex, member, location, name, mode) \
+   vertexAttribute<decltype(Vertex::member), mode>(location, name, offsetof(Vertex, member))
+#define VERTEX_ATTRIBUTE_RUN(Vertex, first, last, location, name, mode) \
+   vertexAttributeRun<decltype(Vertex::first), decltype(Vertex::last), \
+		      (offsetof(Vertex, last) - offsetof(Vertex, first)) / sizeof(Vertex::first) + 1, mode>(location, name, offsetof(Vertex, first))
+
+/* Specialized once per vertex struct, right next to it:
+ *    template<> struct VertexFormat<MeshVertex> {
+ *       static constexpr VertexAttribute attributes[] = { VERTEX_ATTRIBUTE(...), ... };
+ *    };
+ * Everything below checks and uses that table at compile time. */
+template<typename Vertex> struct VertexFormat;
+
+/* the attributes fit inside the struct, do not overlap, have distinct locations and are
+ * aligned to their component size, a misaligned attribute is a slow path on most drivers */
+template<typename Vertex>
+constexpr bool validVertexFormat() {
+   constexpr size_t count = sizeof(VertexFormat<Vertex>::attributes) / sizeof(VertexAttribute);
+   for (size_t i = 0; i < count; i++) {
+      const VertexAttribute& a = VertexFormat<Vertex>::attributes[i];
+      if (a.offset + a.bytes > sizeof(Vertex) || a.offset % (a.bytes / a.components) != 0) {
+	 return false;
+      }
+      for (size_t j = i + 1; j < count; j++) {
+	 const VertexAttribute& b = VertexFormat<Vertex>::attributes[j];
+	 if (a.location == b.location || (a.offset < b.offset + b.bytes && b.offset < a.offset + a.bytes)) {
+	    return false;
+	 }
+      }
+   }
+   return sizeof(Vertex) % 4 == 0;	// so every vertex starts 4-byte aligned
+}
+
+void applyVertexAttributes(const VertexAttribute* attributes, size_t count, GLsizei stride, size_t base_offset);
+bool checkVertexInputs(unsigned int program, const VertexAttribute* attributes, size_t count, const char* format_name);
+
+/* Enables and points every attribute of Vertex at the bound GL_ARRAY_BUFFER, base_offset
+ * bytes in, advancing vertex_step whole vertices at a time. Meant for a ContextVertexArray
+ * setup, or a draw that moves its pointers around */
+template<typename Vertex>
+void applyVertexLayout(size_t base_offset = 0, size_t vertex_step = 1) {
+   static_assert(validVertexFormat<Vertex>(), "broken VertexFormat: overlapping, misaligned or out of bounds attributes");
+   applyVertexAttributes(VertexFormat<Vertex>::attributes, sizeof(VertexFormat<Vertex>::attributes) / sizeof(VertexAttribute),
+			 (GLsizei)(vertex_step * sizeof(Vertex)), base_offset);
+}
+
+/* Compares the linked program's active inputs with the layout: every input needs an attribute
+ * of the same name at the same location, int inputs need ATTRIBUTE_INTEGER, and the layout may
+ * not feed more components than the shader reads. Reports and returns false on a mismatch. */
+template<typename Vertex>
+bool checkVertexInputs(unsigned int program, const char* format_name) {
+   static_assert(validVertexFormat<Vertex>(), "broken VertexFormat: overlapping, misaligned or out of bounds attributes");
+   return checkVertexInputs(program, VertexFormat<Vertex>::attributes,
+			    sizeof(VertexFormat<Vertex>::attributes) / sizeof(VertexAttribute), format_name);
+}
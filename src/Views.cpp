@@ -0,0 +1,276 @@
+#include "Views.h"
+
+#include <algorithm> // std::find
+#include <thread> // std::this_thread::yield
+
+/* room for a burst of input while the render thread sits in a blocking swap */
+static const size_t VIEW_EVENT_CAPACITY = 1024;
+
+///----------------///
+///- EVENT THREAD -///
+///----------------///
+
+/* Nothing is posted for a window once its CLOSING is queued: the render thread may hand it
+ * back and the view gets deleted while later events would still point at it */
+static void viewRefreshCallback(GLFWwindow* window) {
+   ViewWindow* view = (ViewWindow*)glfwGetWindowUserPointer(window);
+   if (view->closing) {
+      return;
+   }
+   ViewEvent event;
+   event.type = VIEW_EVENT_REFRESH;
+   event.view = view;
+   view->views->post(event);
+}
+
+static void viewFramebufferSizeCallback(GLFWwindow* window, int width, int height) {
+   ViewWindow* view = (ViewWindow*)glfwGetWindowUserPointer(window);	// https://www.glfw.org/docs/latest/window_guide.html#window_fbsize
+   if (view->closing) {
+      return;
+   }
+   ViewEvent event;
+   event.type = VIEW_EVENT_RESIZE;
+   event.view = view;
+   event.width = width;
+   event.height = height;
+   view->views->post(event);
+}
+
+ViewSet::ViewSet(FrameDamage& damage)
+   : m_Damage(damage), m_Events(VIEW_EVENT_CAPACITY), m_Released(VIEW_EVENT_CAPACITY) {
+}
+
+ViewSet::~ViewSet() {
+   /* secondaries first, the primary's context is the one everything else was shared from */
+   for (size_t i = m_Open.size(); i-- > 0;) {
+      ViewWindow* view = m_Open[i];
+      glfwMakeContextCurrent(view->window);
+      delete view->render_target;
+      ContextVertexArray::forgetContext(view->window);
+      glfwMakeContextCurrent(NULL);
+      glfwDestroyWindow(view->window);
+      delete view;
+   }
+}
+
+ViewWindow* ViewSet::open(int width, int height, const char* title, void* user) {
+   GLFWwindow* share = m_Open.empty() ? NULL : m_Open[0]->window;
+   GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, share);	// https://www.glfw.org/docs/latest/context_guide.html#context_sharing
+   if (!window) {
+      return nullptr;
+   }
+
+   ViewWindow* view = new ViewWindow();
+   view->window = window;
+   view->views = this;
+   view->user = user;
+   glfwGetFramebufferSize(window, &view->framebuffer_width, &view->framebuffer_height);
+
+   glfwSetWindowUserPointer(window, view);
+   glfwSetWindowRefreshCallback(window, viewRefreshCallback);
+   glfwSetFramebufferSizeCallback(window, viewFramebufferSizeCallback);
+
+   m_Open.push_back(view);
+
+   ViewEvent event;
+   event.type = VIEW_EVENT_OPENED;
+   event.view = view;
+   post(event);
+   return view;
+}
+
+bool ViewSet::update() {
+   if (m_Open.empty() || glfwWindowShouldClose(m_Open[0]->window)) {
+      return true;
+   }
+
+   for (size_t i = 1; i < m_Open.size(); i++) {
+      ViewWindow* view = m_Open[i];
+      if (!view->closing && glfwWindowShouldClose(view->window)) {
+	 view->closing = true;
+	 /* the application's callbacks too, they cannot know the view is on its way out */
+	 glfwSetWindowRefreshCallback(view->window, NULL);
+	 glfwSetFramebufferSizeCallback(view->window, NULL);
+	 glfwSetKeyCallback(view->window, NULL);
+	 ViewEvent event;
+	 event.type = VIEW_EVENT_CLOSING;
+	 event.view = view;
+	 post(event);
+      }
+   }
+
+   /* the render thread has dropped these contexts, nothing can be using them anymore */
+   ViewWindow* released;
+   while (m_Released.pop(released)) {
+      glfwDestroyWindow(released->window);
+      m_Open.erase(std::find(m_Open.begin(), m_Open.end(), released));
+      delete released;
+   }
+   return false;
+}
+
+void ViewSet::post(const ViewEvent& event) {
+   /* only full if the render thread stalled for a very long time, input is not dropped */
+   while (!m_Events.push(event)) {
+      std::this_thread::yield();
+   }
+
+   /* the lock pairs with the check in waitForEvents, so the wakeup cannot slip in between */
+   {
+      std::lock_guard<std::mutex> lock(m_WakeMutex);
+   }
+   m_Wake.notify_one();
+}
+
+///-----------------///
+///- RENDER THREAD -///
+///-----------------///
+
+/* frees what this context owns and hands the window back for destruction */
+void ViewSet::releaseWindow(ViewWindow* view) {
+   glfwMakeContextCurrent(view->window);
+   delete view->render_target;
+   view->render_target = nullptr;
+   ContextVertexArray::forgetContext(view->window);
+   glfwMakeContextCurrent(m_Windows[0]->window);
+
+   m_Windows.erase(std::find(m_Windows.begin(), m_Windows.end(), view));
+   while (!m_Released.push(view)) {
+      std::this_thread::yield();
+   }
+   glfwPostEmptyEvent(); // wakes the event thread out of glfwWaitEvents	// https://www.glfw.org/docs/latest/group__window.html#gab5997a25187e9fd5c6f2ecbbc8dfd7e9
+}
+
+bool ViewSet::drawing(const ViewWindow* view) const {
+   return std::find(m_Windows.begin(), m_Windows.end(), view) != m_Windows.end();
+}
+
+bool ViewSet::nextEvent(ViewEvent& event) {
+   while (m_Events.pop(event)) {
+      /* a window already handed back may be deleted by now, whatever is still queued for it is dropped */
+      if (event.view && event.type != VIEW_EVENT_OPENED && !drawing(event.view)) {
+	 continue;
+      }
+      switch (event.type) {
+      case VIEW_EVENT_KEY:
+      case VIEW_EVENT_QUIT:
+	 return true;
+      case VIEW_EVENT_RESIZE:
+	 event.view->framebuffer_width = event.width;
+	 event.view->framebuffer_height = event.height;
+	 event.view->resized = true;
+	 m_Damage.mark(DAMAGE_WINDOW);
+	 break;
+      case VIEW_EVENT_REFRESH:
+	 m_Damage.mark(DAMAGE_WINDOW);
+	 break;
+      case VIEW_EVENT_OPENED:
+	 m_Windows.push_back(event.view);
+	 m_Damage.mark(DAMAGE_WINDOW);
+	 break;
+      case VIEW_EVENT_CLOSING:
+	 releaseWindow(event.view);
+	 m_Damage.mark(DAMAGE_WINDOW);
+	 break;
+      }
+   }
+   return false;
+}
+
+void ViewSet::waitForEvents(double seconds) {
+   std::unique_lock<std::mutex> lock(m_WakeMutex);
+   m_Wake.wait_for(lock, std::chrono::duration<double>(seconds), [&] { return !m_Events.empty(); });
+}
+
+void ViewSet::drawAll(const std::function<void(ViewWindow& window, int viewport)>& draw) {
+   /* uploads made in the primary's context have to be flushed before another context reads them */
+   if (m_Windows.size() > 1) {
+      GLCall(glFlush());	// https://docs.gl/gl4/glFlush
+   }
+
+   /* back to front so the primary, the only one waiting for vblank, swaps last */
+   for (size_t i = m_Windows.size(); i-- > 0;) {
+      ViewWindow& view = *m_Windows[i];
+      glfwMakeContextCurrent(view.window);
+
+      if (!view.render_target) { // first time this context is current on the render thread
+	 /* a blocking swap per window would divide the frame rate by the window count */
+	 glfwSwapInterval(i == 0 ? 1 : 0);
+	 view.render_target = new ScaledRenderTarget(view.framebuffer_width, view.framebuffer_height);
+      } else if (view.resized) {
+	 view.render_target->resize(view.framebuffer_width, view.framebuffer_height);
+      }
+      view.resized = false;
+
+      view.render_target->begin();
+      GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));	// https://docs.gl/gl4/glClear
+
+      const int width = view.render_target->width();
+      const int height = view.render_target->height();
+      for (int column = 0; column < view.viewport_columns; column++) {
+	 const int x0 = width * column / view.viewport_columns;
+	 const int x1 = width * (column + 1) / view.viewport_columns;
+	 GLCall(glViewport(x0, 0, x1 - x0, height));
+	 GLCall(glScissor(x0, 0, x1 - x0, height));
+	 draw(view, column);
+      }
+
+      view.render_target->end();
+      glfwSwapBuffers(view.window);
+   }
+}
+
+///-----------------------------///
+///- PER-CONTEXT VERTEX ARRAYS -///
+///-----------------------------///
+
+/* every live ContextVertexArray, so a closing window can be scrubbed from all of them */
+static std::vector<ContextVertexArray*>& contextVertexArrays() {
+   static std::vector<ContextVertexArray*> arrays;
+   return arrays;
+}
+
+ContextVertexArray::ContextVertexArray(std::function<void()> setup)
+   : m_Setup(std::move(setup)) {
+   contextVertexArrays().push_back(this);
+}
+
+ContextVertexArray::~ContextVertexArray() {
+   GLFWwindow* context = glfwGetCurrentContext();
+   for (const std::pair<GLFWwindow*, unsigned int>& array : m_Arrays) {
+      if (array.first == context) {
+	 glDeleteVertexArrays(1, &array.second);
+      }
+   }
+
+   std::vector<ContextVertexArray*>& arrays = contextVertexArrays();
+   arrays.erase(std::find(arrays.begin(), arrays.end(), this));
+}
+
+void ContextVertexArray::bind() {
+   GLFWwindow* context = glfwGetCurrentContext();
+   for (const std::pair<GLFWwindow*, unsigned int>& array : m_Arrays) {
+      if (array.first == context) {
+	 GLCall(glBindVertexArray(array.second));
+	 return;
+      }
+   }
+
+   unsigned int vertex_array;
+   GLCall(glGenVertexArrays(1, &vertex_array));
+   GLCall(glBindVertexArray(vertex_array));
+   m_Setup();
+   m_Arrays.push_back({ context, vertex_array });
+}
+
+void ContextVertexArray::forgetContext(GLFWwindow* context) {
+   for (ContextVertexArray* vertex_array : contextVertexArrays()) {
+      std::vector<std::pair<GLFWwindow*, unsigned int>>& arrays = vertex_array->m_Arrays;
+      for (size_t i = arrays.size(); i-- > 0;) {
+	 if (arrays[i].first == context) {
+	    glDeleteVertexArrays(1, &arrays[i].second);	// the context is still current here
+	    arrays.erase(arrays.begin() + i);
+	 }
+      }
+   }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Renderer.h"
+#include "FrameDamage.h"
+#include "ScaledRenderTarget.h"
+#include "SpscQueue.h"
+#include "../dependencies/GLFW/include/GLFW/glfw3.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class ViewSet;
+
+/* One window showing the shared scene, split into side-by-side viewport columns.
+ * window and closing belong to the event thread, everything else to the render thread */
+struct ViewWindow {
+   GLFWwindow* window = nullptr;
+   bool closing = false;		// its context is being handed back for destruction
+
+   int framebuffer_width = 0;		// in pixels, can differ from the window size on hidpi screens
+   int framebuffer_height = 0;
+   bool resized = false;
+   int viewport_columns = 1;
+
+   ScaledRenderTarget* render_target = nullptr;	// framebuffers are per context, so one per window
+   ViewSet* views = nullptr;
+   void* user = nullptr;			// for the application's own callbacks
+};
+
+enum ViewEventType : unsigned int {
+   VIEW_EVENT_KEY = 0,		// handed to the application
+   VIEW_EVENT_QUIT,		// handed to the application, the render loop should end
+   VIEW_EVENT_RESIZE,		// the rest are handled inside ViewSet
+   VIEW_EVENT_REFRESH,
+   VIEW_EVENT_OPENED,
+   VIEW_EVENT_CLOSING,
+};
+
+struct ViewEvent {
+   ViewEventType type = VIEW_EVENT_REFRESH;
+   ViewWindow* view = nullptr;
+   int key = 0;
+   int action = 0;
+   int width = 0;
+   int height = 0;
+};
+
+/* Every window after the first is created sharing the first one's context, so buffers, textures
+ * and programs exist once and data is uploaded once no matter how many views show it.
+ * Only the primary window syncs to vblank, the others swap right before it.
+ *
+ * Two threads use it. The event thread (the one glfw was initialized on) creates and destroys
+ * windows and runs the callbacks, the render thread holds the contexts, draws and swaps.
+ * Everything in between goes through lock-free queues, so a swap blocked on vblank never
+ * holds up input. */
+class ViewSet {
+private:
+   std::vector<ViewWindow*> m_Windows;	// render thread: the ones being drawn, [0] is the primary
+   std::vector<ViewWindow*> m_Open;	// event thread: every window not destroyed yet
+   FrameDamage& m_Damage;
+
+   SpscQueue<ViewEvent> m_Events;	// event thread -> render thread
+   SpscQueue<ViewWindow*> m_Released;	// render thread -> event thread, contexts it let go of
+
+   std::mutex m_WakeMutex;
+   std::condition_variable m_Wake;
+
+   void releaseWindow(ViewWindow* view);
+   bool drawing(const ViewWindow* view) const;
+
+public:
+   explicit ViewSet(FrameDamage& damage);
+   /* event thread, after the render thread is gone */
+   ~ViewSet();
+
+   ViewSet(const ViewSet&) = delete;
+   ViewSet& operator=(const ViewSet&) = delete;
+
+   ///- EVENT THREAD -///
+
+   /* the first window opened becomes the primary, returns nullptr if glfw fails.
+    * No context is made current, the render thread picks the window up from the queue */
+   ViewWindow* open(int width, int height, const char* title, void* user = nullptr);
+
+   /* hands secondary windows that were asked to close to the render thread and destroys
+    * the ones it gave back, true once the primary was asked to close */
+   bool update();
+
+   /* queues for the render thread and wakes it up */
+   void post(const ViewEvent& event);
+
+   ///- RENDER THREAD -///
+
+   /* handles window bookkeeping itself and returns the events meant for the application */
+   bool nextEvent(ViewEvent& event);
+   /* sleeps until something is posted, at most seconds */
+   void waitForEvents(double seconds);
+
+   size_t size() const { return m_Windows.size(); }
+   ViewWindow* primary() const { return m_Windows.empty() ? nullptr : m_Windows[0]; }
+   ViewWindow* window(size_t i) const { return m_Windows[i]; }
+
+   /* Draws every viewport of every window. draw runs with the viewport already set and
+    * cleared, in that window's context. Ends with the primary's context current. */
+   void drawAll(const std::function<void(ViewWindow& window, int viewport)>& draw);
+};
+
+/* Vertex array objects are one of the few things shared contexts do not share. A drawable that
+ * can show up in several windows keeps one per context, each built on first use by setup */
+class ContextVertexArray {
+private:
+   std::vector<std::pair<GLFWwindow*, unsigned int>> m_Arrays;
+   std::function<void()> m_Setup;
+
+public:
+   explicit ContextVertexArray(std::function<void()> setup);
+   /* deletes the current context's array, the others die with their contexts */
+   ~ContextVertexArray();
+
+   ContextVertexArray(const ContextVertexArray&) = delete;
+   ContextVertexArray& operator=(const ContextVertexArray&) = delete;
+
+   void bind();
+
+   /* drops every array that belonged to a window that is about to be destroyed */
+   static void forgetContext(GLFWwindow* context);
+};
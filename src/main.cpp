@@ -1,142 +1,22 @@
 //-- !!! docs.gl !!! --// gl4
 
-#include "../dependencies/GLEW/glew.h"
+#include "Renderer.h"
+#include "FrameDamage.h"
+#include "Views.h"
+#include "FrameArena.h"
+#include "GpuResources.h"
+#include "JobSystem.h"
+#include "FrameStreamer.h"
+#include "ProceduralShapes.h"
+#include "DebugDraw.h"
 #include "../dependencies/GLFW/include/GLFW/glfw3.h"
 
 #include <math.h> // math
 #include <iostream> // input/output stream
-#include <fstream> // file stream
 #include <string> // strings!
-#include <sstream> //string stream
-#include <signal.h> // Error handler
-
-#define	ASSERT(x) do { if (!(x)) raise(SIGTRAP); } while(0)
-#define GLCall(x) GLClearError();\
-   x;\
-   ASSERT(GLLogCall(#x, __FILE__, __LINE__))
-
-/* :sparkles: error handler :sparkles:*/
-static void GLClearError() {
-   while (glGetError() != GL_NO_ERROR);	// https://docs.gl/gl4/glGetError
-}
-
-static bool GLLogCall(const char* function, const char* file, int line) {
-   while (GLenum error = glGetError()) {
-      std::cout << "[OpenGL Error]: ( " << error << " )" <<
-	 "\n\t\033[35mFunction: \033[37m" << function <<
-	 "\n\t\033[35mFile: \033[37m" << file <<
-	 "\n\t\033[35mLine: \033[37m" << line <<
-	 std::endl;
-
-      if (error == GL_INVALID_ENUM) {
-	 std::cout << "\t\033[35mInvalid: \033[37menum" << std::endl;
-      } else if (error == GL_INVALID_VALUE) {
-	 std::cout << "\t\033[35mInvalid: \033[37mvalue" << std::endl;
-      } else if (error == GL_INVALID_OPERATION) {
-	 std::cout << "\t\033[35mInvalid: \033[37moperation" << std::endl;
-      } else if (error == GL_INVALID_FRAMEBUFFER_OPERATION) {
-	 std::cout << "\t\033[35mInvalid: \033[37mframebuffer operation" << std::endl;
-      } else if (error == GL_OUT_OF_MEMORY) {
-	 std::cout << "\tOut of memory" << std::endl;
-      } else if (error == GL_STACK_UNDERFLOW) {
-	 std::cout << "\tStack underflow" << std::endl;
-      } else if (error == GL_STACK_OVERFLOW) {
-	 std::cout << "\tStack overflow" << std::endl;
-      } else {
-	 std::cout << "\tGood luck with this one ;w;" << std::endl;
-      }
-
-      std::cout << "\033[37m " << std::endl;
-      return false;
-   }
-
-   return true;
-}
-
-struct ShaderProgramSource {
-   std::string VertexSource;
-   std::string FragmentSource;
-};
-
-/* Seperates vertex and fragment shader when reading shader file ( primary.shader ) */
-static ShaderProgramSource ParseShader(const std::string& shaderFilePath) {
-   std::ifstream stream(shaderFilePath); // takes in input file
-   if (!stream.is_open()) {
-      std::cout << "Shader file not open " << shaderFilePath << std::endl;
-   }
-
-   enum class ShaderType {
-      NONE = -1, VERTEX = 0, FRAGMENT = 1
-   };
-
-   std::stringstream ss[2]; // one for vertex, one for fragments
-   std::string currentLine;
-   ShaderType type = ShaderType::NONE;
-
-   while(getline(stream, currentLine)) { // Loops through content until it condition met
-      if (currentLine.find("#shader") != std::string::npos) {
-	 if (currentLine.find("vertex") != std::string::npos) { // checks for vertex, to specify vertex
-	    type = ShaderType::VERTEX;
-	 } else if (currentLine.find("fragment") != std::string::npos) { // checks for fragment to specify fragment
-	    type = ShaderType::FRAGMENT;
-	 }
-      } else {
-	 ss[(int)type] << currentLine << '\n'; 
-      }
-   }
-
-   return { ss[0].str(), ss[1].str() };
-}
-
-static unsigned int compileShader(unsigned int type, const std::string& source) {
-   GLCall(unsigned int id = glCreateShader(type));			// https://docs.gl/gl4/glCreateShader
-
-   GLCall(const char* src = source.c_str());
-
-   GLCall(glShaderSource(id, 1, &src, nullptr));			// https://docs.gl/gl4/glShaderSource
-   GLCall(glCompileShader(id));						// https://docs.gl/gl4/glCompileShader	
-
-   int shaderResult;
-
-   GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &shaderResult));		// https://docs.gl/gl4/glGetShader	
-
-   if (shaderResult == GL_FALSE){
-      int logLength;
-      GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &logLength));	// https://docs.gl/gl4/glGetShader
-
-      char* errorMessage = (char*)alloca(logLength*sizeof(char));	// https://www.geeksforgeeks.org/c/pointer-arithmetics-in-c-with-examples/
-									// https://www.man7.org/linux/man-pages/man3/alloca.3.html
-      GLCall(glGetShaderInfoLog(id, logLength, &logLength, errorMessage));	// https://docs.gl/gl4/glGetShaderInfoLog
-
-      std::cout << "CompileShader:\n\tshaderResult " <<
-	 (type == GL_VERTEX_SHADER ? "vertex: " : "fragment ")		// checks shader type
-	 <<"= GL_FALSE" << std::endl;
-      std::cout << errorMessage << std::endl;
-
-      GLCall(glDeleteShader(id));					// https://docs.gl/gl4/glDeleteShader
-
-      return 0;
-   }
-
-   return id;
-}
-
-static unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader) { // Taking in source code of shaders as strings
-   GLCall(unsigned int program = glCreateProgram());	// https://docs.gl/gl4/glCreateProgram
-
-   GLCall(unsigned int vtxShader = compileShader(GL_VERTEX_SHADER, vertexShader));
-   GLCall(unsigned int frgShader = compileShader(GL_FRAGMENT_SHADER, fragmentShader));
-
-   GLCall(glAttachShader(program, vtxShader));		// https://docs.gl/gl4/glAttachShader	
-   GLCall(glAttachShader(program, frgShader));
-
-   GLCall(glLinkProgram(program));			// https://docs.gl/gl4/glLinkProgram
-   GLCall(glValidateProgram(program));			// https://docs.gl/gl4/glValidateProgram 
-
-   GLCall(glDeleteShader(vtxShader));			// https://docs.gl/gl4/glDeleteShader
-   GLCall(glDeleteShader(frgShader));
-   return program; 
-}
+#include <string.h> // strcmp
+#include <algorithm> // std::max
+#include <thread> // render thread
 
 /* increments the colors in our little transition thingy */
 float colorIncrementor(float color, float &increment) {
@@ -155,30 +35,55 @@ float colorIncrementor(float color, float &increment) {
    return color;
 }
 
-int main(void) {
-   GLCall(GLFWwindow* window); // Defines the window varaible to a "GLFWwindow*" "datatype" (?)
+/* the scene is drawn straight in NDC */
+static const float IDENTITY[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
 
-   /* Initialize glfw */
-   if (!glfwInit()) { // If glfw failed to initialze, notify
-      std::cout << "Failed to initialize GLFW" << std::endl;
-      return -1;
-   }
+/* how long an idle render loop sleeps before checking for new simulation data on its own */
+static const double IDLE_WAIT_SECONDS = 0.25;
 
-   float monitor_x, monitor_y;
-   monitor_x = 1980.0;
-   monitor_y = 1120.0;
+/* transient per-frame CPU data, reset after every swap */
+static const size_t FRAME_ARENA_BYTES = 4 << 20;
 
-   /* Create a windowed mode window and its OpenGL context */
-   GLCall(window = glfwCreateWindow((int) monitor_x, (int) monitor_y, "Hello World", NULL, NULL)); // window function(x, y, name, NULL, NULL
+/* frames drawn before the allocation guard is armed, the first ones create render targets and such */
+static const int WARMUP_FRAMES = 2;
 
-   if (!window) { // If the window failed to initialize, terminates the glfw proccess
-      GLCall(glfwTerminate());
-      return -1;
+/* state the glfw callbacks need, every window reaches it through ViewWindow::user.
+ * The callbacks run on the event thread, the scene itself belongs to the render thread */
+struct SceneState {
+   FrameDamage damage;
+   bool open_view = false;	// n asks for another window on the same scene
+};
+
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+   (void)scancode; (void)mods;
+   ViewWindow* view = (ViewWindow*)glfwGetWindowUserPointer(window);
+   SceneState* state = (SceneState*)view->user;
+
+   if (action != GLFW_PRESS || view->closing) { // the view may be gone by the time the render thread sees it
+      return;
    }
-   /* Make the window's context current */
-   GLCall(glfwMakeContextCurrent(window)); // Selects window that's going to be edited(?)
 
-   GLCall(glfwSwapInterval(1));	// syncs refresh-rate to that of the monitor
+   if (key == GLFW_KEY_N) {
+      state->open_view = true; // glfwCreateWindow must not be called from a callback
+      return;
+   }
+
+   /* everything else changes the scene, that is up to the render thread */
+   ViewEvent event;
+   event.type = VIEW_EVENT_KEY;
+   event.view = view;
+   event.key = key;
+   event.action = action;
+   view->views->post(event);
+}
+
+/* All the GL work. The primary's context stays current on this thread until it returns,
+ * input and window management carry on in main meanwhile, however long a swap blocks.
+ * With a stream_address every frame of the primary is also streamed to local viewers */
+static void renderLoop(ViewSet* views, SceneState* state, JobSystem* jobs, const char* stream_address) {
+   ViewEvent event;
+   views->nextEvent(event); // picks up the primary, its OPENED was posted before this thread started
+   glfwMakeContextCurrent(views->primary()->window);
 
    /* Initialze glew */
    if (glewInit() != GLEW_OK) { // If glew failed to initialize, notify
@@ -192,36 +97,9 @@ int main(void) {
       -1.0f,		-1.0f, //0.998214286f,	// vertex 3: x: -0.5f, y:  0.5f
    };
 
-   /* Index buffer */
-   unsigned int triangle_indices[] = { // Allows us to reuse coordinates from memory
-      0, 1, 3,		// triangle: 1: vertex: 0, 1 and 2
-      3, 1, 2,		// traingle: 2: vertex: 2, 3 and 0
-   };
-
-   unsigned int triangle_buffer;				// unsigned int needed
-   GLCall(glGenBuffers(1,&triangle_buffer)); 			// Generates 'n' amount of buffers assigned to an uint	// https://docs.gl/gl4/glGenBuffers
-   GLCall(glBindBuffer(GL_ARRAY_BUFFER, triangle_buffer));	// Bound buffer is the one future commands will edit!!	// https://docs.gl/gl4/glBindBuffer
-   GLCall(glBufferData(GL_ARRAY_BUFFER, 4 * 2 * sizeof(float), triangle_coordinates, GL_STATIC_DRAW)); // data to gpu?	// https://docs.gl/gl4/glBufferData
-
-   GLCall(glEnableVertexAttribArray(0));					// https://docs.gl/gl4/glVertexAttribPointer
-   GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0));  // https://docs.gl/gl4/glEnableVertexAttribArray
-
-   unsigned int ibo;				// Index buffer object
-   GLCall(glGenBuffers(1, &ibo));			// Generates a new buffer
-   GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo)); 	// Binds it to an Element array buffer
-   GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * sizeof(unsigned int), triangle_indices, GL_STATIC_DRAW));
-
-   ShaderProgramSource source = ParseShader("../res/shaders/primary.shader");
-
-   unsigned int shader = createShader(source.VertexSource, source.FragmentSource);
-   GLCall(glUseProgram(shader));
-
-   GLCall(glUseProgram(0));
-   GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
-   GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-
-   GLCall(int location = glGetUniformLocation(shader, "u_Color"));
-   ASSERT(location != -1);
+   /* Owns the bar's uniform block and program, deleting one waits until the gpu is done with it.
+    * The debug overlay, render targets and streamer still manage their own objects */
+   GpuResources* gpu = new GpuResources();
 
    /* RGB */
    float r, g, b, a;
@@ -230,70 +108,229 @@ int main(void) {
    b = 0.0f;
    a = 1.0f;
 
+   /* The bar has no vertices, the vertex shader builds it from its corners in a uniform block.
+    * triangle_coordinates stays the CPU side, only the corners and color that change are uploaded */
+   ProceduralShapes* shapes = new ProceduralShapes(*gpu);
+   const float bar_color[4] = { r, g, b, a };
+   const unsigned int bar = shapes->addQuad(triangle_coordinates[6], triangle_coordinates[7],
+					    triangle_coordinates[2], triangle_coordinates[1], bar_color);
+   const View2D ndc;	// the scene is drawn straight in NDC
+
    /* Increment */
    float basei = 1.0/255;
 
-   /* pixel sizes */
+   /* pixel sizes of the primary window, updated when it is resized */
    float pix_x, pix_y;
-   pix_x = 1.0/monitor_x;
-   pix_y = 1.0/monitor_y;
+
+   FrameArena frame_arena(FRAME_ARENA_BYTES);
+   dbg::init(frame_arena); // debug overlays are recorded into the frame arena
+
+   FrameStreamer* streamer = nullptr;
+   if (stream_address) {
+      streamer = new FrameStreamer(*jobs);
+      if (!streamer->open(stream_address)) {
+	 delete streamer;
+	 streamer = nullptr;
+      }
+   }
+   int frames_drawn = 0;
+   size_t windows_drawn = 0;
+   bool animating = true;	// space toggles
+   bool debug_overlay = false;	// d toggles
+
+   /* Render here, once per viewport of every window. The buffers and the program are shared
+    * so nothing is uploaded twice, only the (per context) attribute setup is repeated.
+    * Built once out here, wrapping the lambda in a std::function every frame would allocate */
+   const std::function<void(ViewWindow&, int)> draw_scene = [&](ViewWindow& view, int viewport) {
+      (void)view; (void)viewport;
+
+      shapes->draw(ndc);
+
+      dbg::flush(IDENTITY);
+   };
 
    ///------------///   
    ///- MAINLOOP -///
    ///------------///
 
-   /* Loop until the user closes the window */
-   while (!glfwWindowShouldClose(window)) {
-      /* Render here */
-      GLCall(glClear(GL_COLOR_BUFFER_BIT));	// https://docs.gl/gl4/glClear
+   /* Loop until the event thread says the primary window was closed */
+   bool running = true;
+   while (running) {
+      FrameAllocationGuard::disarm(); // window bookkeeping below may allocate
+
+      while (views->nextEvent(event)) {
+	 if (event.type == VIEW_EVENT_QUIT) {
+	    running = false;
+	 } else if (event.key == GLFW_KEY_SPACE) {
+	    animating = !animating;
+	 } else if (event.key == GLFW_KEY_S) {
+	    event.view->viewport_columns = event.view->viewport_columns % 4 + 1; // cycles 1 to 4 side-by-side viewports
+	    state->damage.mark(DAMAGE_WINDOW);
+	 } else if (event.key == GLFW_KEY_D) {
+	    debug_overlay = !debug_overlay;
+	    state->damage.mark(DAMAGE_WINDOW);
+	 }
+      }
+      if (!running) {
+	 break;
+      }
 
-      GLCall(glUseProgram(shader));
-      GLCall(glUniform4f(location, r, g, b, a));
+      /* a new window is not steady state, its first frames create its render target */
+      if (views->size() != windows_drawn) {
+	 windows_drawn = views->size();
+	 frames_drawn = 0;
+      }
+      /* from here on the loop must not touch the heap, -DFRAME_ALLOCATION_CHECK traps if it does */
+      if (frames_drawn >= WARMUP_FRAMES) {
+	 FrameAllocationGuard::arm();
+      }
 
-      GLCall(glBindBuffer(GL_ARRAY_BUFFER, triangle_buffer));
-      
-      GLCall(glEnableVertexAttribArray(0));					
-      GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0));
+      /* Update here, whatever changes marks the frame as damaged */
+      pix_x = 1.0/std::max(1, views->primary()->framebuffer_width);
+      pix_y = 1.0/std::max(1, views->primary()->framebuffer_height);
+
+      if (animating) {
+	 b = colorIncrementor(b, basei);
+	 g = colorIncrementor(g, basei);
+	 r = colorIncrementor(r, basei);
+	 shapes->setColor(bar, r, g, b, a); // 16 bytes
+	 state->damage.mark(DAMAGE_UNIFORMS);
+
+	 if (triangle_coordinates[2] < 1.0f || triangle_coordinates[4] < 1.0f) { // bar stops once it is full
+	    triangle_coordinates[2] += pix_x;
+	    triangle_coordinates[4] += pix_x;
+
+	    if (triangle_coordinates[2] >= 1.0f) {
+	       triangle_coordinates[2] = 1.0f;
+	    }
+	    if (triangle_coordinates[4] >= 1.0f) {
+	       triangle_coordinates[4] = 1.0f;
+	    }
+	    shapes->setCorners(bar, triangle_coordinates[6], triangle_coordinates[7], triangle_coordinates[2], triangle_coordinates[1]);
+
+//	    triangle_coordinates[5] += -pix_y;
+//	    triangle_coordinates[7] += -pix_y;
+//
+//	    if (triangle_coordinates[5] <= -1.0f) {
+//	       triangle_coordinates[5] = -1.0f;
+//	    }
+//	    if (triangle_coordinates[7] <= -1.0f) {
+//	       triangle_coordinates[7] = -1.0f;
+//	    }
+
+	    state->damage.mark(DAMAGE_DATA);
+	 }
+      }
 
-      GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo));
+      if (streamer) {
+	 streamer->poll(); // readbacks finish on their own time, also while nothing is drawn
+      }
 
-      b = colorIncrementor(b, basei);
-      g = colorIncrementor(g, basei);
-      r = colorIncrementor(r, basei);
+      /* Nothing changed, sleep until an event comes in instead of drawing the same frame again */
+      if (!state->damage.take()) { // marks landing after this go into the next frame
+	 views->waitForEvents(IDLE_WAIT_SECONDS);
+	 continue;
+      }
 
-      GLCall(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));	// https://docs.gl/gl4/glDrawElements
-      
-      triangle_coordinates[2] += pix_x;
-      triangle_coordinates[4] += pix_x;
+      if (debug_overlay) {
+	 /* outline of the bar, one line loop through its corners */
+	 dbg::begin(GL_LINE_LOOP);
+	 dbg::color(1.0f, 1.0f, 1.0f);
+	 for (int corner = 0; corner < 4; corner++) {
+	    dbg::vertex(triangle_coordinates[2 * corner], triangle_coordinates[2 * corner + 1]);
+	 }
+	 dbg::end();
+      }
 
-      if (triangle_coordinates[2] >= 1.0f) {
-	 triangle_coordinates[2] = 1.0f;
+      /* on the primary's context, drawAll flushes it before any other window reads the buffers */
+      shapes->upload();
+      dbg::upload();
+      views->drawAll(draw_scene); // swaps the back and front buffer of every window, allowing us to view displayed info in the previous back-buffer
+      if (streamer) {
+	 const ScaledRenderTarget* target = views->primary()->render_target;
+	 streamer->capture(target->framebuffer(), target->renderedWidth(), target->renderedHeight()); // end() already rescaled for the next frame
       }
-      if (triangle_coordinates[4] >= 1.0f) {
-	 triangle_coordinates[4] = 1.0f;
+      dbg::clear(); // its vertices live in the arena
+      frame_arena.reset();
+      gpu->endFrame();
+      frames_drawn++;
+   }
+
+   FrameAllocationGuard::disarm();
+   shapes->uploads().printStats("procedural shapes");
+   /* everything GL goes while the context still exists, finish() deletes what is still pending */
+   delete shapes;
+   dbg::shutdown();
+   gpu->finish();
+   delete gpu;
+   delete streamer;
+
+   glfwMakeContextCurrent(NULL); // main takes the contexts back to destroy them
+}
+
+int main(int argc, char** argv) {
+   GLCall(GLFWwindow* window); // Defines the window varaible to a "GLFWwindow*" "datatype" (?)
+
+   /* Initialize glfw */
+   if (!glfwInit()) { // If glfw failed to initialze, notify
+      std::cout << "Failed to initialize GLFW" << std::endl;
+      return -1;
+   }
+
+   /* --stream <port or unix socket path>: no visible window, frames go to local viewers instead */
+   const char* stream_address = nullptr;
+   for (int i = 1; i + 1 < argc; i++) {
+      if (strcmp(argv[i], "--stream") == 0) {
+	 stream_address = argv[++i];
       }
-      
-//      triangle_coordinates[5] += -pix_y;
-//      triangle_coordinates[7] += -pix_y;
-//      
-//      if (triangle_coordinates[5] <= -1.0f) {
-//	 triangle_coordinates[5] = -1.0f;
-//      }
-//      if (triangle_coordinates[7] <= -1.0f) {
-//	 triangle_coordinates[7] = -1.0f;
-//      }
+   }
+   if (stream_address) {
+      glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);	// https://www.glfw.org/docs/latest/window_guide.html#window_hints_wnd
+   }
+
+   float monitor_x, monitor_y;
+   monitor_x = 1980.0;
+   monitor_y = 1120.0;
+
+   SceneState state;
+   ViewSet* views = new ViewSet(state.damage); // every window after the first shares its buffers and programs
 
-      GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(triangle_coordinates), triangle_coordinates));
+   /* Create a windowed mode window and its OpenGL context, the render thread makes it current and syncs it to the monitor */
+   ViewWindow* primary = views->open((int) monitor_x, (int) monitor_y, "Hello World", &state); // window function(x, y, name, scene)
 
+   if (!primary) { // If the window failed to initialize, terminates the glfw proccess
+      delete views;
+      glfwTerminate();
+      return -1;
+   }
+   window = primary->window;
+   glfwSetKeyCallback(window, keyCallback);
 
-      /* Swap front and back buffers */
-      GLCall(glfwSwapBuffers(window)); // swaps the back and front buffer, allowing us to view displayed info in the previous back-buffer
+   JobSystem jobs; // CPU side work, shared by everything that runs in parallel
 
-      /* Poll for and process events */
-      GLCall(glfwPollEvents()); // Detects events, and is most likely just an even handler (?)
+   /* Rendering gets its own thread, glfw events have to stay on this one */
+   std::thread render_thread(renderLoop, views, &state, &jobs, stream_address);
+
+   /* Loop until the user closes the primary window, closing any other one just closes that view */
+   while (!views->update()) {
+      if (state.open_view) {
+	 ViewWindow* view = views->open(640, 640, "Hello World", &state);
+	 if (view) {
+	    glfwSetKeyCallback(view->window, keyCallback);
+	 }
+	 state.open_view = false;
+      }
+
+      /* Wait for and process events, the render thread wakes this up when it hands a window back */
+      glfwWaitEvents();	// https://www.glfw.org/docs/latest/group__window.html#ga554e37d781f0a997656c26b2c56c835e
    }
 
-   glDeleteProgram(shader);	// https://docs.gl/gl4/glDeleteProgram
+   ViewEvent quit;
+   quit.type = VIEW_EVENT_QUIT;
+   views->post(quit);
+   render_thread.join();
+
+   delete views;	// needs the contexts, so before glfwTerminate
 
    glfwTerminate(); // Terminates glfw process
    return 0;
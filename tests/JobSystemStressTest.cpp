@@ -0,0 +1,136 @@
+/* Hammers JobSystem from several threads at once, meant to run under ThreadSanitizer.
+ * CPU only, from the repository root:
+ *    g++ -std=c++17 -O1 -g -fsanitize=thread tests/JobSystemStressTest.cpp src/JobSystem.cpp -o job_system_stress_test -pthread && ./job_system_stress_test
+ * Exits with 1 on the first failed check, the sanitizer reports races on its own */
+
+#include "../src/JobSystem.h"
+
+#include <atomic>
+#include <iostream> // input/output stream
+#include <stdlib.h> // exit
+#include <thread>
+#include <vector>
+
+#define CHECK(x) do { if (!(x)) { std::cout << "[JobSystemStressTest]: " << __FILE__ << ":" << __LINE__ << " failed: " #x << std::endl; exit(1); } } while(0)
+
+/* every index exactly once, at a few sizes and grains */
+static void parallelForCoversEveryIndex(JobSystem& jobs) {
+   for (size_t count : { (size_t)0, (size_t)1, (size_t)7, (size_t)1000, (size_t)100000 }) {
+      for (size_t grain : { (size_t)0, (size_t)1, (size_t)64 }) {
+	 std::vector<std::atomic<int>> hits(count);
+	 for (std::atomic<int>& hit : hits) {
+	    hit.store(0);
+	 }
+	 jobs.parallelFor(count, [&](size_t i) { hits[i].fetch_add(1, std::memory_order_relaxed); }, grain);
+	 for (size_t i = 0; i < count; i++) {
+	    CHECK(hits[i].load() == 1);
+	 }
+      }
+   }
+}
+
+static void nestedParallelFor(JobSystem& jobs) {
+   const size_t outer = 64, inner = 2000;
+   std::vector<std::atomic<int>> hits(outer * inner);
+   for (std::atomic<int>& hit : hits) {
+      hit.store(0);
+   }
+   jobs.parallelFor(outer, [&](size_t i) {
+      jobs.parallelFor(inner, [&](size_t j) { hits[i * inner + j].fetch_add(1, std::memory_order_relaxed); });
+   });
+   for (const std::atomic<int>& hit : hits) {
+      CHECK(hit.load() == 1);
+   }
+}
+
+/* each link only runs after the one before it, a plain int is enough if the ordering holds */
+static void dependencyChains(JobSystem& jobs) {
+   const int links = 500;
+   struct Chain {
+      int value = 0;
+      bool ordered = true;
+   } chain;
+   Chain* c = &chain;
+
+   JobHandle previous = nullptr;
+   for (int link = 0; link < links; link++) {
+      JobHandle next = jobs.run([c, link] {
+	 if (c->value != link) {
+	    c->ordered = false;
+	 }
+	 c->value++;
+      }, { previous });
+      jobs.release(previous);
+      previous = next;
+   }
+   jobs.wait(previous);
+   CHECK(chain.ordered && chain.value == links);
+
+   /* fan in: one job after many */
+   std::atomic<int> before(0);
+   std::atomic<int> seen(-1);
+   std::atomic<int>* b = &before;
+   std::atomic<int>* s = &seen;
+   JobHandle first[6];
+   for (JobHandle& handle : first) {
+      handle = jobs.run([b] { b->fetch_add(1); });
+   }
+   JobHandle last = jobs.run([b, s] { s->store(b->load()); }, { first[0], first[1], first[2], first[3], first[4], first[5] });
+   for (JobHandle handle : first) {
+      jobs.release(handle);
+   }
+   jobs.wait(last);
+   CHECK(seen.load() == 6);
+}
+
+/* a pool of 16 jobs and far more submitted: the rest run inline on the submitting thread */
+static void poolExhaustion() {
+   JobSystem small(4, 16);
+   std::atomic<int> done(0);
+   std::atomic<int>* d = &done;
+   std::vector<JobHandle> handles;
+   for (int i = 0; i < 2000; i++) {
+      handles.push_back(small.run([d] { d->fetch_add(1); }));
+   }
+   for (JobHandle handle : handles) {
+      small.wait(handle);
+   }
+   CHECK(done.load() == 2000);
+
+   std::atomic<int> hits(0);
+   small.parallelFor(10000, [&](size_t) { hits.fetch_add(1, std::memory_order_relaxed); }, 1);
+   CHECK(hits.load() == 10000);
+}
+
+/* threads that are not workers submitting and waiting at the same time, through the shared queue */
+static void externalThreads(JobSystem& jobs) {
+   std::atomic<int> total(0);
+   std::vector<std::thread> threads;
+   for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&jobs, &total] {
+	 for (int round = 0; round < 50; round++) {
+	    std::atomic<int>* sum = &total;
+	    JobHandle job = jobs.run([sum] { sum->fetch_add(1); });
+	    jobs.parallelFor(100, [sum](size_t) { sum->fetch_add(1, std::memory_order_relaxed); });
+	    jobs.wait(job);
+	 }
+      });
+   }
+   for (std::thread& thread : threads) {
+      thread.join();
+   }
+   CHECK(total.load() == 4 * 50 * 101);
+}
+
+int main() {
+   JobSystem jobs(8, 1024);
+   for (int repeat = 0; repeat < 20; repeat++) {
+      parallelForCoversEveryIndex(jobs);
+      nestedParallelFor(jobs);
+      dependencyChains(jobs);
+      externalThreads(jobs);
+   }
+   poolExhaustion();
+   std::cout << "[JobSystemStressTest]: all passed" << std::endl;
+   return 0;
+}
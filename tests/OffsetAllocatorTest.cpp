@@ -0,0 +1,122 @@
+/* CPU only, OffsetAllocator never touches GL. From the repository root:
+ *    g++ -std=c++17 -O2 tests/OffsetAllocatorTest.cpp src/OffsetAllocator.cpp -o offset_allocator_test && ./offset_allocator_test
+ * Exits with 1 on the first failed check */
+
+#include "../src/OffsetAllocator.h"
+
+#include <iostream> // input/output stream
+#include <random> // std::mt19937
+#include <stdlib.h> // exit
+#include <vector>
+
+#define CHECK(x) do { if (!(x)) { std::cout << "[OffsetAllocatorTest]: " << __FILE__ << ":" << __LINE__ << " failed: " #x << std::endl; exit(1); } } while(0)
+
+/* every size in the first few thousand, then a spread up to the top bins */
+static void fitSizeFits() {
+   for (uint32_t size = 1; size < 1 << 24; size = size < 4096 ? size + 1 : size + size / 7) {
+      const uint32_t fit = OffsetAllocator::fitSize(size);
+      CHECK(fit >= size);
+      OffsetAllocator allocator(fit, 4);
+      OffsetAllocator::Allocation allocation = allocator.allocate(size);
+      CHECK(allocation.offset == 0);
+   }
+}
+
+/* 300 and 700 fill a 1000 range exactly, the 700 one is where allocating again fails */
+static void packedFillsTheRange() {
+   OffsetAllocator allocator(1000, 16);
+   const uint32_t sizes[2] = { 300, 700 };
+   OffsetAllocator::Allocation allocations[2];
+   allocator.resetPacked(sizes, 2, allocations);
+   CHECK(allocations[0].offset == 0 && allocations[1].offset == 300);
+   CHECK(allocator.allocationSize(allocations[1]) == 700);
+   CHECK(allocator.freeStorage() == 0 && allocator.tailFree() == 0);
+
+   allocator.free(allocations[1]);
+   CHECK(allocator.tailFree() == 700);
+   allocator.free(allocations[0]);
+   CHECK(allocator.tailFree() == 1000 && allocator.freeStorage() == 1000);
+}
+
+/* leaves room behind the packed blocks as one free block, which merges on free */
+static void packedLeavesOneTail() {
+   OffsetAllocator allocator(1000, 16);
+   const uint32_t sizes[3] = { 10, 20, 30 };
+   OffsetAllocator::Allocation allocations[3];
+   allocator.resetPacked(sizes, 3, allocations);
+   CHECK(allocations[2].offset == 30 && allocator.tailFree() == 940);
+   allocator.free(allocations[2]);
+   CHECK(allocator.tailFree() == 970);
+   allocator.free(allocations[0]);
+   allocator.free(allocations[1]);
+   CHECK(allocator.tailFree() == 1000 && allocator.freeStorage() == 1000);
+}
+
+/* what BufferPool::allocate does on a full pool: grow so the end block is found */
+static void growToFit() {
+   OffsetAllocator allocator(1024, 16);
+   OffsetAllocator::Allocation full = allocator.allocate(1024);
+   CHECK(full.offset == 0);
+   CHECK(allocator.allocate(2000).node == OffsetAllocator::NO_SPACE);
+
+   allocator.grow(allocator.size() - allocator.tailFree() + OffsetAllocator::fitSize(2000));
+   OffsetAllocator::Allocation grown = allocator.allocate(2000);
+   CHECK(grown.offset == 1024);
+   allocator.free(full);
+   allocator.free(grown);
+   CHECK(allocator.tailFree() == allocator.size());
+}
+
+/* random allocate and free against a map of the range: nothing overlaps, nothing leaks */
+static void randomOperations() {
+   const uint32_t size = 1 << 20;
+   OffsetAllocator allocator(size, 4096);
+   std::vector<unsigned char> owner(size, 0);
+   std::vector<OffsetAllocator::Allocation> live;
+   std::mt19937 random(1234);
+   uint32_t used = 0;
+
+   for (int step = 0; step < 200000; step++) {
+      if (live.size() < 2000 && (live.empty() || random() % 3 != 0)) {
+	 const uint32_t units = 1 + random() % (random() % 8 == 0 ? 20000 : 300);
+	 OffsetAllocator::Allocation allocation = allocator.allocate(units);
+	 if (allocation.node == OffsetAllocator::NO_SPACE) {
+	    continue;
+	 }
+	 CHECK(allocation.offset + units <= size);
+	 for (uint32_t i = allocation.offset; i < allocation.offset + units; i++) {
+	    CHECK(owner[i] == 0);
+	    owner[i] = 1;
+	 }
+	 used += units;
+	 live.push_back(allocation);
+      } else {
+	 const size_t pick = random() % live.size();
+	 const OffsetAllocator::Allocation allocation = live[pick];
+	 const uint32_t units = allocator.allocationSize(allocation);
+	 for (uint32_t i = allocation.offset; i < allocation.offset + units; i++) {
+	    owner[i] = 0;
+	 }
+	 used -= units;
+	 allocator.free(allocation);
+	 live[pick] = live.back();
+	 live.pop_back();
+      }
+      CHECK(allocator.freeStorage() == size - used);
+   }
+
+   for (const OffsetAllocator::Allocation& allocation : live) {
+      allocator.free(allocation);
+   }
+   CHECK(allocator.freeStorage() == size && allocator.tailFree() == size);
+}
+
+int main() {
+   fitSizeFits();
+   packedFillsTheRange();
+   packedLeavesOneTail();
+   growToFit();
+   randomOperations();
+   std::cout << "[OffsetAllocatorTest]: all passed" << std::endl;
+   return 0;
+}
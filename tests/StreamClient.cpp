@@ -0,0 +1,157 @@
+/* Viewer side of FrameStreamer's wire format, for checking a running stream by hand. Connects,
+ * reassembles every update into the full frame, checks each one against the format and writes
+ * the last frame out as a binary PPM. From the repository root:
+ *    g++ -std=c++17 -O2 tests/StreamClient.cpp -o stream_client -lz
+ *    ./display --stream /tmp/display.sock &
+ *    ./stream_client /tmp/display.sock 100 frame.ppm
+ * Takes the same addresses as --stream. Exits with 1 on the first malformed update */
+
+#include "../src/FrameStreamer.h"
+
+#include <iostream> // input/output stream
+#include <fstream> // file stream
+#include <stdlib.h> // atoi, exit
+#include <string.h> // memcpy, memcmp, strerror
+#include <errno.h> // errno
+#include <arpa/inet.h> // htons, htonl
+#include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // socket, connect, recv
+#include <sys/un.h> // sockaddr_un
+#include <unistd.h> // close
+#include <vector>
+#include <zlib.h> // uncompress
+
+#define CHECK(x) do { if (!(x)) { std::cout << "[StreamClient]: malformed update, " #x << std::endl; exit(1); } } while(0)
+
+static int connectTo(const std::string& address) {
+   int fd;
+   if (address.compare(0, 5, "unix:") == 0 || (!address.empty() && address[0] == '/')) {
+      const std::string path = address[0] == '/' ? address : address.substr(5);
+      sockaddr_un socket_address = {};
+      socket_address.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(socket_address.sun_path)) {
+	 return -1;
+      }
+      memcpy(socket_address.sun_path, path.c_str(), path.size() + 1);
+      fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd >= 0 && connect(fd, (const sockaddr*)&socket_address, sizeof(socket_address)) < 0) {
+	 ::close(fd);
+	 return -1;
+      }
+   } else {
+      sockaddr_in socket_address = {};
+      socket_address.sin_family = AF_INET;
+      socket_address.sin_port = htons((uint16_t)atoi(address.c_str()));
+      socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd >= 0 && connect(fd, (const sockaddr*)&socket_address, sizeof(socket_address)) < 0) {
+	 ::close(fd);
+	 return -1;
+      }
+   }
+   return fd;
+}
+
+/* false once the stream closed */
+static bool receive(int fd, void* data, size_t size) {
+   unsigned char* bytes = (unsigned char*)data;
+   while (size > 0) {
+      const ssize_t got = recv(fd, bytes, size, 0);
+      if (got < 0 && errno == EINTR) {
+	 continue;
+      }
+      if (got <= 0) {
+	 return false;
+      }
+      bytes += got;
+      size -= got;
+   }
+   return true;
+}
+
+/* rows come bottom-up like glReadPixels, PPM wants them top-down and without alpha */
+static void writePpm(const char* path, const std::vector<unsigned char>& pixels, uint32_t width, uint32_t height) {
+   std::ofstream out(path, std::ios::binary);
+   out << "P6\n" << width << " " << height << "\n255\n";
+   for (uint32_t y = height; y-- > 0;) {
+      for (uint32_t x = 0; x < width; x++) {
+	 out.write((const char*)&pixels[((size_t)y * width + x) * 4], 3);
+      }
+   }
+}
+
+int main(int argc, char** argv) {
+   if (argc < 2) {
+      std::cout << "usage: stream_client <port | unix socket path> [updates] [out.ppm]" << std::endl;
+      return 1;
+   }
+   const int updates = argc > 2 ? atoi(argv[2]) : 100;
+   const char* ppm_path = argc > 3 ? argv[3] : nullptr;
+
+   const int fd = connectTo(argv[1]);
+   if (fd < 0) {
+      std::cout << "[StreamClient]: could not connect to " << argv[1] << ": " << strerror(errno) << std::endl;
+      return 1;
+   }
+
+   std::vector<unsigned char> pixels;
+   std::vector<unsigned char> compressed;
+   std::vector<unsigned char> tile(FrameStreamer::TILE_SIZE * FrameStreamer::TILE_SIZE * 4);
+   uint32_t width = 0, height = 0, last_frame = 0;
+   size_t bytes = 0;
+
+   int update = 0;
+   for (; update < updates; update++) {
+      StreamFrameHeader header;
+      if (!receive(fd, &header, sizeof(header))) {
+	 break;
+      }
+      CHECK(memcmp(header.magic, "SVF1", 4) == 0);
+      CHECK(header.tile_size == (uint32_t)FrameStreamer::TILE_SIZE);
+      CHECK(header.width > 0 && header.height > 0);
+      CHECK(update == 0 || header.frame > last_frame);
+
+      const uint32_t tiles_x = (header.width + header.tile_size - 1) / header.tile_size;
+      const uint32_t tiles_y = (header.height + header.tile_size - 1) / header.tile_size;
+      CHECK(header.tile_count <= tiles_x * tiles_y);
+      /* the first update and every one after a resize carry the whole frame */
+      if (header.width != width || header.height != height) {
+	 CHECK(header.tile_count == tiles_x * tiles_y);
+	 width = header.width;
+	 height = header.height;
+	 pixels.assign((size_t)width * height * 4, 0);
+      }
+
+      for (uint32_t i = 0; i < header.tile_count; i++) {
+	 uint32_t tile_header[2];
+	 CHECK(receive(fd, tile_header, sizeof(tile_header)));
+	 const uint32_t t = tile_header[0];
+	 CHECK(t < tiles_x * tiles_y);
+	 compressed.resize(tile_header[1]);
+	 CHECK(receive(fd, compressed.data(), compressed.size()));
+	 bytes += sizeof(tile_header) + compressed.size();
+
+	 const uint32_t x0 = t % tiles_x * header.tile_size;
+	 const uint32_t y0 = t / tiles_x * header.tile_size;
+	 const uint32_t columns = std::min(header.tile_size, width - x0);
+	 const uint32_t rows = std::min(header.tile_size, height - y0);
+	 uLongf size = tile.size();
+	 CHECK(uncompress(tile.data(), &size, compressed.data(), compressed.size()) == Z_OK);	// https://www.zlib.net/manual.html#Utility
+	 CHECK(size == (uLongf)columns * rows * 4);
+	 for (uint32_t y = 0; y < rows; y++) {
+	    memcpy(&pixels[((size_t)(y0 + y) * width + x0) * 4], &tile[(size_t)y * columns * 4], (size_t)columns * 4);
+	 }
+      }
+      bytes += sizeof(header);
+      last_frame = header.frame;
+      std::cout << "[StreamClient]: frame " << header.frame << ", " << header.width << "x" << header.height
+		<< ", " << header.tile_count << " tiles" << std::endl;
+   }
+   ::close(fd);
+
+   std::cout << "[StreamClient]: " << update << " updates, " << bytes << " bytes" << std::endl;
+   if (ppm_path && width > 0) {
+      writePpm(ppm_path, pixels, width, height);
+   }
+   return 0;
+}